@@ -0,0 +1,29 @@
+#ifndef ANCHOR_TABLE_HPP
+#define ANCHOR_TABLE_HPP
+
+#include <vector>
+
+// UltraFace prior boxes as flat structure-of-arrays (normalized center x/y, width, height).
+// 320x240 and 640x480 are generated at compile time and live in .rodata; other input sizes are
+// generated once at construction by the same constexpr routine.
+class AnchorTable {
+public:
+    AnchorTable(int input_width, int input_height);
+
+    // A view over four planes of count floats owned by the caller, e.g. the anchors a model carries
+    AnchorTable(const float* planes, int count);
+
+    int size() const { return count; }
+    bool isStatic() const { return storage.empty(); }  // True for views too: nothing generated at runtime
+
+    const float* cx;
+    const float* cy;
+    const float* w;
+    const float* h;
+
+private:
+    int count;
+    std::vector<float> storage;  // Runtime fallback only, four planes of count floats
+};
+
+#endif // ANCHOR_TABLE_HPP
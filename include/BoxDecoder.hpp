@@ -0,0 +1,30 @@
+#ifndef BOX_DECODER_HPP
+#define BOX_DECODER_HPP
+
+#include <vector>
+#include "AnchorTable.hpp"
+#include "FaceInfo.hpp"
+
+// UltraFace output decoding in two steps: a vectorized scan of the face-score column that collects the
+// anchors above threshold, then a 4-wide decode of only those candidates using a polynomial exp.
+// Boxes match the scalar double-precision decoder to within a few float ulps.
+class BoxDecoder {
+public:
+    BoxDecoder(const AnchorTable& anchors, float center_variance, float size_variance);
+
+    // scores is the [anchors, 2] softmax output; appends indices whose face score exceeds threshold
+    void scan(const float* scores, float threshold, std::vector<int>& candidates) const;
+
+    // boxes is the [anchors, 4] regression output; appends one FaceInfo in image pixels per candidate
+    void decode(const float* scores, const float* boxes, const std::vector<int>& candidates, int image_w,
+                int image_h, std::vector<FaceInfo>& faces) const;
+
+    static const char* kernelName();
+
+private:
+    const AnchorTable& anchors;
+    float center_variance;
+    float size_variance;
+};
+
+#endif // BOX_DECODER_HPP
@@ -0,0 +1,10 @@
+#ifndef CAM_FRAME_HPP
+#define CAM_FRAME_HPP
+
+// Channel order of an 8-bit, 3-channel camera frame
+enum PixelFormat {
+    PIXEL_FORMAT_BGR = 0,
+    PIXEL_FORMAT_RGB = 1
+};
+
+#endif // CAM_FRAME_HPP
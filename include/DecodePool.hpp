@@ -0,0 +1,68 @@
+#ifndef DECODE_POOL_HPP
+#define DECODE_POOL_HPP
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FrameConverter.hpp"
+
+// Decodes captured frames on a small pool of worker threads and publishes them in capture order.
+// submit() never blocks: with every worker busy, the oldest waiting frame is dropped to make room,
+// and a frame that finishes after a newer one has already been published is dropped too, so the
+// detector only ever sees increasing sequence numbers and no backlog builds up.
+class DecodePool {
+public:
+    typedef std::function<void(const cv::Mat& frame, PixelFormat format, int64_t timestamp_us,
+                               size_t bytes_copied)> PublishCallback;
+
+    struct Stats {
+        uint64_t submitted;
+        uint64_t published;
+        uint64_t dropped_waiting;  // Replaced by a newer frame before a worker picked it up
+        uint64_t dropped_late;     // Decoded, but a newer frame was published first
+        uint64_t failed;
+    };
+
+    DecodePool(int workers, JpegDecoderBackend backend, int out_width, int out_height, PublishCallback publish);
+    ~DecodePool();
+
+    void submit(const CapturedFrame& frame, int64_t timestamp_us);  // From the capture thread only
+    Stats getStats() const;
+    int getWorkerCount() const;
+
+private:
+    struct Job {
+        std::vector<unsigned char> data;  // Reused between frames
+        CapturedFrame frame;
+        uint64_t sequence;
+        int64_t timestamp_us;
+    };
+
+    void workerLoop(int index);
+
+    int out_w;
+    int out_h;
+    PublishCallback publish;
+
+    mutable std::mutex mutex;
+    std::condition_variable job_ready;
+    std::deque<std::unique_ptr<Job>> waiting;
+    std::vector<std::unique_ptr<Job>> free_jobs;
+    bool stopping;
+    uint64_t next_sequence;
+
+    std::mutex publish_mutex;  // Serializes publishing, which keeps a single writer on the frame ring
+    uint64_t last_published;
+
+    std::vector<std::unique_ptr<FrameConverter>> converters;
+    std::vector<std::thread> threads;
+    Stats stats;
+};
+
+#endif // DECODE_POOL_HPP
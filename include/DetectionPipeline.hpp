@@ -0,0 +1,78 @@
+#ifndef DETECTION_PIPELINE_HPP
+#define DETECTION_PIPELINE_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "SpscQueue.hpp"
+#include "UltraFace.hpp"
+
+#define PIPELINE_SLOTS 3
+
+// UltraFace split over three threads: preprocess, runSession and postprocess/NMS. Each frame in flight owns
+// one of three contexts (its own session, input and outputs), so frame N+1 is preprocessed and frame N-1
+// post-processed while frame N is inferred. Stages hand slot indices to each other through lock-free
+// single-producer queues, and a slot returns to the preprocess stage once its result has been delivered.
+class DetectionPipeline {
+public:
+    // Called on the preprocess thread when a slot is free. Returns false when there is no frame to run yet.
+    // The frame only needs to stay valid until the next call.
+    typedef std::function<bool(cv::Mat& frame, PixelFormat& format, int64_t& timestamp_us)> FrameProvider;
+    // Called on the postprocess thread. faces is only valid during the call; timing is this frame's time in
+    // each stage. Frames whose inference failed are dropped without a call.
+    typedef std::function<void(int64_t timestamp_us, const std::vector<FaceInfo>& faces,
+                               const DetectTiming& timing)> ResultCallback;
+
+    struct Stats {
+        uint64_t frames;
+        uint64_t failed;        // Dropped because inference failed
+        double fps;             // Results per second since start()
+        double latency_ms_avg;  // Frame timestamp to result delivered
+        double latency_ms_max;
+        double stage_ms[3];     // Average time per frame in preprocess, infer, postprocess
+    };
+
+    DetectionPipeline(UltraFace& detector, FrameProvider provider, ResultCallback done);
+    ~DetectionPipeline();
+
+    bool start();  // false when a stage's session could not be created
+    void stop();  // Frames still in flight are discarded
+    Stats getStats() const;
+
+private:
+    struct Slot {
+        std::unique_ptr<UltraFaceContext> context;
+        int64_t timestamp_us;
+        bool inferred;  // Set by the infer stage; false leaves stale outputs that must not be decoded
+    };
+
+    void preprocessLoop();
+    void inferLoop();
+    void postprocessLoop();
+    bool waitPop(SpscQueue<int, PIPELINE_SLOTS>& queue, int& slot);
+
+    UltraFace& detector;
+    FrameProvider provider;
+    ResultCallback done;
+    Slot slots[PIPELINE_SLOTS];
+
+    SpscQueue<int, PIPELINE_SLOTS> free_slots;    // postprocess -> preprocess
+    SpscQueue<int, PIPELINE_SLOTS> ready_slots;   // preprocess -> infer
+    SpscQueue<int, PIPELINE_SLOTS> output_slots;  // infer -> postprocess
+
+    std::atomic<bool> running;
+    std::vector<std::thread> threads;
+
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> failed;
+    std::atomic<int64_t> latency_us_total;
+    std::atomic<int64_t> latency_us_max;
+    std::atomic<int64_t> stage_us_total[3];
+    int64_t start_us;
+};
+
+#endif // DETECTION_PIPELINE_HPP
@@ -0,0 +1,59 @@
+#ifndef DETECTOR_BACKEND_HPP
+#define DETECTOR_BACKEND_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "CamFrame.hpp"
+#include "FusedPreprocessor.hpp"
+
+// One runnable instance of the network: its input buffer, its outputs and whatever the runtime needs to run
+// them. A session is only ever used by one thread at a time.
+class BackendSession {
+public:
+    virtual ~BackendSession() {}
+
+    // Plans input and outputs for batch x 3 x height x width. Returns -1 when the model can't take that batch
+    // or the runtime fails to plan it.
+    virtual int resize(int batch) = 0;
+
+    // Fills one batch slot of the input from an 8-bit frame
+    virtual void writeInput(FusedPreprocessor& preprocessor, const uint8_t* src, int src_w, int src_h,
+                            int src_stride, PixelFormat format, int batch_index) = 0;
+
+    virtual int run() = 0;
+
+    // anchors x 2 scores and anchors x 4 boxes per image, valid until the next run() or resize()
+    virtual const float* scores() = 0;
+    virtual const float* boxes() = 0;
+
+    virtual int outputBatch() const = 0;  // Can be less than the input batch when the graph folds it
+
+    // For graphs with post-processing fused in (FaceDecodeNms): points rows at the final faces, six floats each
+    // (image index, x1, y1, x2, y2, score), and returns the row count. -1 when the graph outputs scores and boxes.
+    virtual int fusedFaces(const float** rows) {
+        return -1;
+    }
+
+    virtual size_t outputBytesCopied() const = 0;  // By the last scores() and boxes(), 0 when read in place
+};
+
+// A loaded model. Sessions created from it share the weights; creating one is safe from any thread. Each
+// session has its own input size, so one loaded model serves every size its graph accepts.
+class DetectorBackend {
+public:
+    virtual ~DetectorBackend() {}
+
+    // nullptr when the runtime can't create one, or the graph is fixed to another input size
+    virtual std::unique_ptr<BackendSession> createSession(int input_width, int input_height, int anchor_count) = 0;
+
+    virtual const char* name() const = 0;
+
+    // type is "mnn" or "onnx", or empty to go by the model file extension. Returns nullptr when the model can't
+    // be loaded or the backend isn't compiled in.
+    static std::unique_ptr<DetectorBackend> create(const std::string& model_path, const std::string& type,
+                                                   int num_thread);
+};
+
+#endif // DETECTOR_BACKEND_HPP
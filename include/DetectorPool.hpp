@@ -0,0 +1,86 @@
+#ifndef DETECTOR_POOL_HPP
+#define DETECTOR_POOL_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "UltraFace.hpp"
+
+// Runs detection for several streams on N sessions of one loaded model, one worker thread per session.
+// Each worker has its own queue; submit() spreads frames round-robin, and a worker whose queue runs dry
+// steals the newest frame from the back of the busiest one, so no session idles while another has a backlog.
+// Sessions that fail to create are left out; with none at all, submit() answers every frame with -1.
+class DetectorPool {
+public:
+    // Runs on the worker thread. faces is only valid during the call.
+    typedef std::function<void(int status, const std::vector<FaceInfo>& faces)> ResultCallback;
+
+    struct SessionStats {
+        uint64_t jobs;
+        uint64_t stolen;     // Jobs taken from another session's queue
+        double utilization;  // Fraction of the pool's lifetime spent in detect()
+    };
+
+    struct Stats {
+        uint64_t submitted;
+        uint64_t completed;
+        double queue_ms_avg;  // Submit to start of detect()
+        double queue_ms_max;
+        std::vector<SessionStats> sessions;
+    };
+
+    DetectorPool(UltraFace& detector, int sessions);
+    ~DetectorPool();
+
+    // frame must stay unchanged until done runs; cv::Mat's reference count keeps an owned buffer alive.
+    // Without sessions, done runs right away on the caller's thread.
+    void submit(const cv::Mat& frame, PixelFormat format, ResultCallback done);
+    Stats getStats() const;
+    int getSessionCount() const;  // Sessions actually created, at most the number asked for
+
+private:
+    struct Job {
+        cv::Mat frame;
+        PixelFormat format;
+        ResultCallback done;
+        int64_t submitted_us;
+    };
+
+    struct Session {
+        std::unique_ptr<UltraFaceContext> context;
+        mutable std::mutex mutex;
+        std::deque<Job> queue;
+        uint64_t jobs = 0;
+        uint64_t stolen = 0;
+        int64_t busy_us = 0;
+    };
+
+    bool takeJob(int index, Job& job, bool& stolen);
+    void workerLoop(int index);
+
+    UltraFace& detector;
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<std::thread> threads;
+
+    std::mutex wake_mutex;
+    std::condition_variable job_ready;
+    std::atomic<int> pending;
+    std::atomic<unsigned> next_session;
+    bool stopping;
+
+    mutable std::mutex stats_mutex;
+    uint64_t submitted;
+    uint64_t completed;
+    int64_t queue_us_total;
+    int64_t queue_us_max;
+    int64_t start_us;
+};
+
+#endif // DETECTOR_POOL_HPP
@@ -0,0 +1,37 @@
+#ifndef FACE_DECODE_NMS_OP_HPP
+#define FACE_DECODE_NMS_OP_HPP
+
+#ifdef USE_ONNXRUNTIME
+
+#include <cstdint>
+#include "onnxruntime_cxx_api.h"
+#include "onnxruntime_lite_custom_op.h"
+
+#define FACE_OP_DOMAIN "ai.smartcam"
+
+// FaceDecodeNms: UltraFace post-processing as a graph node, the same BoxDecoder and NmsEngine code
+// UltraFace runs on the CPU. Added to an exported model by tools/fuse_postprocess.py.
+//   inputs  scores [N, A, 2], boxes [N, A, 4], anchors [4, A] (cx, cy, w, h planes), image_sizes [N, 2] (w, h)
+//   output  faces [M, 6]: image index, x1, y1, x2, y2 in image pixels, score
+//   attributes score_threshold, iou_threshold, nms_type, topk, center_variance, size_variance
+struct FaceDecodeNmsKernel {
+    FaceDecodeNmsKernel(const OrtApi* api, const OrtKernelInfo* info);
+
+    Ort::Status Compute(const Ort::Custom::Tensor<float>& scores, const Ort::Custom::Tensor<float>& boxes,
+                        const Ort::Custom::Tensor<float>& anchors, const Ort::Custom::Tensor<float>& image_sizes,
+                        Ort::Custom::Tensor<float>& faces);
+
+    float score_threshold;
+    float iou_threshold;
+    int nms_type;
+    int topk;
+    float center_variance;
+    float size_variance;
+};
+
+// Registers the FACE_OP_DOMAIN ops on options. The domain lives for the whole process.
+void addFaceOps(Ort::SessionOptions& options);
+
+#endif // USE_ONNXRUNTIME
+
+#endif // FACE_DECODE_NMS_OP_HPP
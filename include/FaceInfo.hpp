@@ -0,0 +1,13 @@
+#ifndef FACE_INFO_HPP
+#define FACE_INFO_HPP
+
+typedef struct FaceInfo {
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+    float score;
+
+} FaceInfo;
+
+#endif // FACE_INFO_HPP
@@ -0,0 +1,67 @@
+#ifndef FACE_TRACKER_HPP
+#define FACE_TRACKER_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "CamFrame.hpp"
+#include "FaceInfo.hpp"
+
+// Single-face tracker for the frames between detector runs. sync() takes a grayscale template of the
+// largest detected face, downscaled so it is at most 32 px wide; update() finds it again by normalized
+// cross-correlation in a window around the last position. The template is only refreshed by sync(), so
+// errors don't build up between detections. needsDetection() asks for a new detection after
+// resync_interval tracked frames, or once the match score falls below min_confidence.
+class FaceTracker {
+public:
+    struct Stats {
+        uint64_t syncs;
+        uint64_t updates;       // Frames tracked successfully
+        uint64_t lost;          // Matches below min_confidence
+        double track_ms_avg;    // One update(), tracked or lost
+        double confidence_avg;  // Over successful updates
+    };
+
+    FaceTracker(int resync_interval = 10, float min_confidence = 0.6f);
+
+    void setResyncInterval(int frames);
+    void setMinConfidence(float score);
+    void setSearchMargin(float margin);  // Per side, as a fraction of the face size; default 0.5
+
+    // Follows the largest of faces from now on; no faces stops tracking
+    void sync(const cv::Mat& frame, PixelFormat format, const std::vector<FaceInfo>& faces);
+
+    // face receives the tracked box in frame pixels, with the match score as its score. false, and face
+    // untouched, when nothing is tracked or the match is too weak.
+    bool update(const cv::Mat& frame, PixelFormat format, FaceInfo& face);
+
+    bool needsDetection() const;
+    bool isTracking() const;
+    Stats getStats() const;
+
+private:
+    void grayRegion(const cv::Mat& frame, PixelFormat format, const cv::Rect& rect, cv::Mat& gray);
+
+    int resync_interval;
+    float min_confidence;
+    float search_margin;
+
+    bool tracking;
+    FaceInfo target;  // Last tracked box, in frame pixels
+    float scale;      // Template pixels per frame pixel
+    int frames_since_sync;
+    cv::Mat templ;
+
+    cv::Mat color;  // Scratch
+    cv::Mat search;
+    cv::Mat result;
+
+    std::atomic<uint64_t> syncs;
+    std::atomic<uint64_t> updates;
+    std::atomic<uint64_t> lost;
+    std::atomic<int64_t> track_us;
+    std::atomic<int64_t> confidence_total;  // Score * 1e6, summed
+};
+
+#endif // FACE_TRACKER_HPP
@@ -0,0 +1,24 @@
+#ifndef FRAME_CONVERTER_HPP
+#define FRAME_CONVERTER_HPP
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include "CamFrame.hpp"
+#include "FrameSource.hpp"
+#include "JpegDecoder.hpp"
+
+// Turns a captured frame (JPEG or YUYV) into the out_width x out_height 8-bit frame the detector reads.
+// Holds decoder state and scratch buffers, so use one per thread.
+class FrameConverter {
+public:
+    FrameConverter(JpegDecoderBackend backend, int out_width, int out_height);
+
+    // dst is written in place, never reallocated
+    bool convert(const CapturedFrame& captured, cv::Mat& dst, PixelFormat& format);
+
+private:
+    std::unique_ptr<JpegDecoder> decoder;
+    cv::Mat scratch;
+};
+
+#endif // FRAME_CONVERTER_HPP
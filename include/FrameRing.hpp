@@ -0,0 +1,69 @@
+#ifndef FRAME_RING_HPP
+#define FRAME_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "CamFrame.hpp"
+
+#define FRAME_RING_SLOTS 3
+
+struct FrameSlotHeader {
+    uint64_t sequence;      // Increments by one per published frame, starting at 1
+    int64_t timestamp_us;   // Capture time, steady clock
+    int32_t width;
+    int32_t height;
+    int32_t format;         // PixelFormat
+    int32_t reserved;
+};
+
+struct FrameSlot {
+    const FrameSlotHeader* header;
+    const unsigned char* data;
+};
+
+// Triple-buffered camera frames in POSIX shared memory, replacing the single /cam_frame buffer.
+// The writer fills its private back slot and publishes it by swapping it with the shared "latest"
+// index; the reader swaps its front slot for the latest one. Neither side ever waits for the other,
+// a published slot is never written again until the reader has let go of it, and frames are read
+// in place.
+class FrameRing {
+public:
+    FrameRing();
+    ~FrameRing();
+
+    bool create(const std::string& name, int max_width, int max_height);
+    void destroy();
+
+    // Writer side (one thread)
+    unsigned char* beginWrite();  // Back slot to fill, max_width * max_height * 3 bytes
+    void commitWrite(int width, int height, PixelFormat format, int64_t timestamp_us);
+
+    // Reader side (one thread). Returns the newest complete frame not returned before, or nullptr.
+    // The slot stays valid and untouched until the next call.
+    const FrameSlot* acquireLatest();
+
+    uint64_t getPublishedCount() const;
+
+    static int64_t now();  // Timestamp for commitWrite(), in microseconds
+
+private:
+    struct Control;
+
+    FrameSlotHeader* slotHeader(int index) const;
+    unsigned char* slotData(int index) const;
+
+    std::string shm_name;
+    int shm_fd;
+    void* base;
+    size_t mapped_size;
+    size_t slot_stride;
+    Control* control;
+
+    int back_index;   // Owned by the writer
+    int front_index;  // Owned by the reader
+    FrameSlot front;
+};
+
+#endif // FRAME_RING_HPP
@@ -0,0 +1,54 @@
+#ifndef FRAME_SCHEDULER_HPP
+#define FRAME_SCHEDULER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define FRAME_AGE_BUCKETS 7
+
+// Keeps capture and inference in lock-step. The capture rate follows a moving average of detector
+// latency, so the camera produces roughly one frame per inference, and frames that have waited
+// longer than the deadline are dropped instead of being inferred on.
+// The capture thread calls shouldCapture(), the detector thread admit() and recordDetectLatency().
+class FrameScheduler {
+public:
+    struct Stats {
+        double detect_latency_ms;  // Moving average
+        double capture_interval_ms;
+        uint64_t frames_admitted;
+        uint64_t frames_dropped;   // Older than the deadline when the detector got to them
+        uint64_t frames_throttled; // Not decoded because the detector could not have used them
+        uint64_t age_histogram[FRAME_AGE_BUCKETS];
+    };
+
+    static const int age_bucket_limits_ms[FRAME_AGE_BUCKETS - 1];  // Upper bounds; the last bucket is open
+
+    explicit FrameScheduler(int deadline_ms = 150, int min_interval_ms = 16, int max_interval_ms = 1000);
+
+    bool shouldCapture(int64_t now_us);
+    int64_t getCaptureIntervalUs() const;
+
+    bool admit(int64_t capture_timestamp_us, int64_t now_us);
+    void recordDetectLatency(int64_t latency_us);
+
+    void reset();  // Forget the latency estimate, e.g. when detection is restarted
+    void setDeadlineMs(int deadline_ms);
+    int getDeadlineMs() const;
+    Stats getStats() const;
+
+private:
+    std::atomic<int64_t> deadline_us;
+    int64_t min_interval_us;
+    int64_t max_interval_us;
+
+    std::atomic<int64_t> latency_average_us;  // 0 until the first sample
+    int64_t last_capture_us;                  // Capture thread only
+
+    std::atomic<uint64_t> frames_admitted;
+    std::atomic<uint64_t> frames_dropped;
+    std::atomic<uint64_t> frames_throttled;
+    std::atomic<uint64_t> age_histogram[FRAME_AGE_BUCKETS];
+};
+
+#endif // FRAME_SCHEDULER_HPP
@@ -0,0 +1,42 @@
+#ifndef FRAME_SOURCE_HPP
+#define FRAME_SOURCE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include "FrameScheduler.hpp"
+
+enum FrameEncoding {
+    FRAME_ENCODING_JPEG = 0,
+    FRAME_ENCODING_YUYV = 1
+};
+
+// One frame as delivered by a source. The pointer is only valid during the callback.
+struct CapturedFrame {
+    const unsigned char* data;
+    size_t size;
+    FrameEncoding encoding;
+    int width;            // Raw encodings only; JPEGs carry their own size
+    int height;
+    int stride;
+    size_t bytes_copied;  // Bytes memcpy'd to get the frame this far
+};
+
+// A camera backend. run() blocks, handing every frame to the callback, until running goes false.
+class FrameSource {
+public:
+    typedef std::function<void(const CapturedFrame& frame)> FrameCallback;
+
+    virtual ~FrameSource() {}
+
+    // Returns false if the source could not be started or failed while streaming
+    virtual bool run(const std::atomic<bool>& running, const FrameCallback& callback) = 0;
+
+    // Sources that poll use the scheduler's capture interval instead of a fixed period
+    void setScheduler(FrameScheduler* frame_scheduler) { scheduler = frame_scheduler; }
+
+protected:
+    FrameScheduler* scheduler = nullptr;
+};
+
+#endif // FRAME_SOURCE_HPP
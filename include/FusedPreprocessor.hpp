@@ -0,0 +1,47 @@
+#ifndef FUSED_PREPROCESSOR_HPP
+#define FUSED_PREPROCESSOR_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Tensor.hpp"
+#include "CamFrame.hpp"
+
+// UltraFace input preprocessing in one pass over the source frame: bilinear resize (the same sampling as
+// cv::resize INTER_LINEAR, in 8-bit fixed point), BGR/RGB -> RGB, (x - mean) * norm and HWC -> planar float.
+// Row kernels exist for NEON, AVX2 and SSSE3 with a scalar fallback; the best one the CPU supports is picked
+// at runtime.
+class FusedPreprocessor {
+public:
+    FusedPreprocessor(const float mean[3], const float norm[3]);
+
+    // Fills one batch slot of the network input. When the tensor lives in host memory (MNN's CPU backend) it
+    // is written in place, in whichever of NCHW / NC4HW4 it uses; otherwise through a cached host staging
+    // tensor, uploaded once the last slot has been written.
+    void convert(const uint8_t* src, int src_w, int src_h, int src_stride, PixelFormat format, MNN::Tensor* input,
+                 int batch_index = 0);
+
+    // The kernel itself: dst_w x dst_h RGB, planar (NCHW) or packed in groups of four channels (NC4HW4)
+    void run(const uint8_t* src, int src_w, int src_h, int src_stride, bool swap_rb, float* dst, int dst_w,
+             int dst_h, bool c4);
+
+    static const char* kernelName();
+
+    // Nearest-neighbour instead of bilinear resizing: cheaper, but aliased on downscales
+    void setBilinear(bool enable);
+
+private:
+    float scale[3];  // norm, per output channel
+    float bias[3];   // -mean * norm, per output channel
+
+    bool bilinear;
+    std::vector<int> x_offsets;  // Source byte offset of each output column's left neighbour
+    std::vector<int> x_next;     // ... and of its right neighbour
+    std::vector<int> x_weights;  // Right neighbour's weight in 1/256ths
+    int offsets_src_w;
+    bool offsets_bilinear;
+    std::vector<uint8_t> row;    // One resampled source row when resizing
+    std::unique_ptr<MNN::Tensor> staging;
+};
+
+#endif // FUSED_PREPROCESSOR_HPP
@@ -0,0 +1,41 @@
+#ifndef HTTP_FRAME_SOURCE_HPP
+#define HTTP_FRAME_SOURCE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include "FrameSource.hpp"
+
+#define HTTP_CAPTURE_SNAPSHOT 0
+#define HTTP_CAPTURE_STREAM 1
+
+// Delay before reconnecting a dropped stream, and before retrying one that gave no frame while snapshots
+// stand in; doubled after each failed attempt up to the cap
+#define HTTP_STREAM_RETRY_MIN_MS 500
+#define HTTP_STREAM_RETRY_MAX_MS 30000
+
+// mjpg-streamer over HTTP: a long-lived ?action=stream connection, or ?action=snapshot polling
+// when the stream is unavailable or the snapshot mode is selected. Snapshots that stand in for an
+// unavailable stream keep retrying it with a capped backoff.
+class HttpFrameSource : public FrameSource {
+public:
+    HttpFrameSource(const std::string& snapshot_url, const std::string& stream_url, int mode = HTTP_CAPTURE_STREAM);
+
+    bool run(const std::atomic<bool>& running, const FrameCallback& callback) override;
+
+    void setMode(int mode);  // Also ends a fallback to snapshots
+    int getMode() const;
+
+private:
+    // Polls until the mode changes or retry_at, when set, passes
+    void runSnapshots(const std::atomic<bool>& running, const FrameCallback& callback,
+                      std::chrono::steady_clock::time_point retry_at);
+    bool runStream(const std::atomic<bool>& running, const FrameCallback& callback);
+
+    std::string snapshot_url;
+    std::string stream_url;
+    std::atomic<int> capture_mode;
+    std::atomic<bool> stream_fallback;  // Snapshot mode was entered because the stream failed
+};
+
+#endif // HTTP_FRAME_SOURCE_HPP
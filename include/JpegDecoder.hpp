@@ -0,0 +1,72 @@
+#ifndef JPEG_DECODER_HPP
+#define JPEG_DECODER_HPP
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <csetjmp>
+#include <cstdio>
+#include <memory>
+#include <jpeglib.h>
+#include "CamFrame.hpp"
+
+enum JpegDecoderBackend {
+    JPEG_DECODER_OPENCV = 0,  // cv::imdecode at full resolution + nearest-neighbour resize
+    JPEG_DECODER_SCALED = 1   // libjpeg-turbo IDCT scaling straight to (about) the output size
+};
+
+// Decodes camera JPEGs into a caller-owned frame (typically a cv::Mat wrapping shared memory).
+// Scratch buffers are kept between calls, so steady-state decoding does not allocate.
+class JpegDecoder {
+public:
+    virtual ~JpegDecoder() {}
+
+    static std::unique_ptr<JpegDecoder> create(JpegDecoderBackend backend, int out_width, int out_height);
+
+    // dst must be out_height x out_width CV_8UC3; it is written in place, never reallocated
+    virtual bool decode(const unsigned char* data, size_t size, cv::Mat& dst) = 0;
+    virtual PixelFormat getPixelFormat() const = 0;
+
+protected:
+    JpegDecoder(int out_width, int out_height) : out_w(out_width), out_h(out_height) {}
+
+    int out_w;
+    int out_h;
+};
+
+class OpenCvJpegDecoder : public JpegDecoder {
+public:
+    OpenCvJpegDecoder(int out_width, int out_height);
+
+    bool decode(const unsigned char* data, size_t size, cv::Mat& dst) override;
+    PixelFormat getPixelFormat() const override { return PIXEL_FORMAT_BGR; }
+
+private:
+    cv::Mat decoded;       // Full-resolution scratch, reused while the camera resolution stays the same
+    cv::Size source_size;  // Resolution of the previous frame
+};
+
+// Uses the 1/2, 1/4 and 1/8 scaled IDCTs so only about as many pixels as the detector needs are
+// ever reconstructed, then area-averages the remainder. Output is RGB, the order UltraFace feeds MNN.
+class ScaledJpegDecoder : public JpegDecoder {
+public:
+    ScaledJpegDecoder(int out_width, int out_height);
+    ~ScaledJpegDecoder();
+
+    bool decode(const unsigned char* data, size_t size, cv::Mat& dst) override;
+    PixelFormat getPixelFormat() const override { return PIXEL_FORMAT_RGB; }
+
+private:
+    struct ErrorManager {
+        struct jpeg_error_mgr pub;
+        jmp_buf setjmp_buffer;
+    };
+
+    static void onError(j_common_ptr cinfo);
+    void readScanlines(cv::Mat& target);
+
+    struct jpeg_decompress_struct cinfo;
+    ErrorManager error;
+    cv::Mat scaled;  // Scratch for when the scaled IDCT output is not exactly the output size
+};
+
+#endif // JPEG_DECODER_HPP
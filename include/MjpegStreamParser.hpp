@@ -0,0 +1,47 @@
+#ifndef MJPEG_STREAM_PARSER_HPP
+#define MJPEG_STREAM_PARSER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Incremental parser for multipart/x-mixed-replace MJPEG streams (mjpg-streamer ?action=stream).
+// Bytes are fed as libcurl delivers them; the frame callback fires once per complete JPEG part.
+// Part bodies are copied exactly once, from the libcurl chunk into a body buffer sized from the
+// part's Content-Length, and that buffer is reused for every frame.
+class MjpegStreamParser {
+public:
+    typedef std::function<void(const unsigned char* data, size_t size)> FrameCallback;
+
+    explicit MjpegStreamParser(FrameCallback callback, const std::string& boundary = "boundarydonotcross");
+
+    void setBoundary(const std::string& boundary);  // Accepts the value of the Content-Type "boundary=" parameter
+    void feed(const char* data, size_t size);
+    void reset();
+    size_t getFrameCount() const;
+    size_t getFrameBytesCopied() const;  // Bytes memcpy'd for the frame being delivered, valid inside the callback
+
+private:
+    enum State { SEEK_BOUNDARY, READ_HEADERS, READ_BODY };
+
+    size_t readPreamble(const char* data, size_t size);
+    size_t readBody(const char* data, size_t size);
+    void reserveBody(size_t size);
+    void emitBody(size_t size);
+
+    FrameCallback on_frame;
+    std::string delimiter;  // "--" + boundary
+    std::string part_end;   // "\r\n--" + boundary, ends a part that has no Content-Length
+    std::string buffer;     // Unconsumed boundary/header bytes
+    std::vector<unsigned char> body;
+    size_t body_size;
+    State state;
+    long content_length;    // -1 when the part has no Content-Length header
+    size_t scan_pos;        // Where the next part_end search resumes in body
+    size_t frame_count;
+    size_t bytes_copied;
+    size_t frame_bytes_copied;
+};
+
+#endif // MJPEG_STREAM_PARSER_HPP
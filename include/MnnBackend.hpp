@@ -0,0 +1,65 @@
+#ifndef MNN_BACKEND_HPP
+#define MNN_BACKEND_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Interpreter.hpp"
+#include "MNNDefine.h"
+#include "Tensor.hpp"
+#include "DetectorBackend.hpp"
+
+class MnnBackend;
+
+class MnnSession : public BackendSession {
+public:
+    ~MnnSession() override;
+
+    int resize(int batch) override;
+    void writeInput(FusedPreprocessor& preprocessor, const uint8_t* src, int src_w, int src_h, int src_stride,
+                    PixelFormat format, int batch_index) override;
+    int run() override;
+    const float* scores() override;
+    const float* boxes() override;
+    int outputBatch() const override;
+    size_t outputBytesCopied() const override;
+
+private:
+    friend class MnnBackend;
+
+    MnnSession(MnnBackend& owner, MNN::Session* session, int input_width, int input_height, int anchor_count);
+
+    const float* outputData(MNN::Tensor* output, std::unique_ptr<MNN::Tensor>& host, int channels);
+
+    MnnBackend& owner;
+    MNN::Session* session;
+    MNN::Tensor* input_tensor;
+    MNN::Tensor* output_scores = nullptr;
+    MNN::Tensor* output_boxes = nullptr;
+    int in_w;
+    int in_h;
+    int anchor_count;
+    int batch = 0;
+    std::unique_ptr<MNN::Tensor> scores_host;  // Only created when the backend can't be read in place
+    std::unique_ptr<MNN::Tensor> boxes_host;
+    size_t bytes_copied = 0;
+};
+
+class MnnBackend : public DetectorBackend {
+public:
+    MnnBackend(MNN::Interpreter* interpreter, int num_thread);
+    ~MnnBackend() override;
+
+    std::unique_ptr<BackendSession> createSession(int input_width, int input_height, int anchor_count) override;
+    const char* name() const override;
+
+private:
+    friend class MnnSession;
+
+    std::shared_ptr<MNN::Interpreter> interpreter;
+    // MNN serializes nothing itself: session creation, resize and release share this lock, runSession does not
+    std::mutex session_mutex;
+    int num_thread;
+};
+
+#endif // MNN_BACKEND_HPP
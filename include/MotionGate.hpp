@@ -0,0 +1,55 @@
+#ifndef MOTION_GATE_HPP
+#define MOTION_GATE_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include "CamFrame.hpp"
+
+// Cheap pre-stage that lets the detector skip frames of a static scene. Each frame is reduced to a
+// 40x30 luma thumbnail and compared with the thumbnail of the last frame that was actually inferred;
+// inference only runs when the mean absolute difference passes the threshold or the last inference
+// is older than the maximum skip interval. Comparing against the last inferred frame rather than the
+// previous one means slow drift still adds up to a re-run.
+class MotionGate {
+public:
+    struct Stats {
+        uint64_t frames;
+        uint64_t skipped;
+        double skip_ratio;
+        double gate_cpu_ms;      // Average per frame
+        double detect_cpu_ms;    // Average per inference
+        double saved_cpu_ms;     // Inference CPU time not spent, net of the gate's own cost
+    };
+
+    MotionGate(float threshold = 3.0f, int max_skip_ms = 1000);
+
+    // threshold <= 0 disables the gate, every frame is inferred
+    void setThreshold(float threshold);
+    void setMaxSkipMs(int max_skip_ms);
+
+    bool shouldDetect(const cv::Mat& frame, PixelFormat format, int64_t timestamp_us);
+    void recordDetectCpuTime(int64_t cpu_us);  // Measure with processCpuTimeUs(), MNN runs on its own threads too
+    Stats getStats() const;
+
+    static int64_t threadCpuTimeUs();
+    static int64_t processCpuTimeUs();
+
+private:
+    std::atomic<float> threshold;
+    std::atomic<int64_t> max_skip_us;
+
+    cv::Mat small;      // Color thumbnail scratch
+    cv::Mat thumbnail;
+    cv::Mat reference;  // Thumbnail of the last inferred frame
+    cv::Mat difference;
+    int64_t last_detect_us;
+
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> skipped;
+    std::atomic<int64_t> gate_cpu_us;
+    std::atomic<int64_t> detect_cpu_us;
+    std::atomic<uint64_t> detections;
+};
+
+#endif // MOTION_GATE_HPP
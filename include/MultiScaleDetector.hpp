@@ -0,0 +1,70 @@
+#ifndef MULTI_SCALE_DETECTOR_HPP
+#define MULTI_SCALE_DETECTOR_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "UltraFace.hpp"
+
+// UltraFace at several network input sizes of one loaded model, each with its own session and anchor table
+// built and warmed up front, so switching sizes between frames costs nothing. Each frame runs at the cheapest size at which
+// the previous frame's face would still be target_face_px wide in the network input. Low confidence moves
+// one size up. With no face, the sizes are cycled from the base size upwards, so both near and distant
+// faces get picked up again.
+class MultiScaleDetector {
+public:
+    struct SizeStats {
+        cv::Size size;
+        uint64_t frames;
+        double detect_ms_avg;  // pre + infer + post
+    };
+
+    struct Stats {
+        uint64_t frames;
+        double detect_ms_avg;  // Over all frames, whichever size they ran at
+        std::vector<SizeStats> sizes;
+    };
+
+    // base_size is the size used when nothing is known yet, normally the one the model was trained for. The
+    // model must accept every size (MNN resizes any fully convolutional model; ONNX exports are often fixed).
+    MultiScaleDetector(const std::string& model_path, std::vector<cv::Size> sizes, cv::Size base_size,
+                       int num_thread = 4, float score_threshold = 0.7, const std::string& backend = "");
+
+    int detect(const cv::Mat& img, std::vector<FaceInfo>& faces, PixelFormat format = PIXEL_FORMAT_BGR);
+
+    void setNmsType(int type);
+    void setTargetFacePx(float px);
+    void setMinConfidence(float score);
+
+    cv::Size lastInputSize() const;
+    const DetectTiming& getLastTiming() const;
+    size_t getLastOutputBytesCopied() const;
+    Stats getStats() const;
+
+    // "160x120,320x240,640x480"; sizes that don't parse are skipped
+    static std::vector<cv::Size> parseSizes(const std::string& text);
+
+private:
+    int select() const;
+
+    std::vector<cv::Size> sizes;  // Ascending by area
+    std::vector<std::unique_ptr<UltraFace>> detectors;
+    int base;
+    int last;  // Index the previous frame ran at
+
+    // Largest face of the previous frame, width as a fraction of the image width
+    bool last_found;
+    float last_face_ratio;
+    float last_score;
+
+    float target_face_px;
+    float min_confidence;
+
+    std::vector<std::atomic<uint64_t>> frames;
+    std::vector<std::atomic<int64_t>> detect_us;
+};
+
+#endif // MULTI_SCALE_DETECTOR_HPP
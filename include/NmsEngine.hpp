@@ -0,0 +1,50 @@
+#ifndef NMS_ENGINE_HPP
+#define NMS_ENGINE_HPP
+
+#include <vector>
+#include "FaceInfo.hpp"
+
+#define hard_nms 1
+#define blending_nms 2 /* mix nms was been proposaled in paper blaze face, aims to minimize the temporal jitter*/
+#define fast_nms 3     /* matrix-form NMS from YOLACT: drop a box if any higher-scoring box overlaps it */
+#define soft_nms 4     /* Gaussian Soft-NMS: overlapping boxes have their score decayed instead of removed */
+
+// Non-maximum suppression over candidate boxes. Boxes are copied into score-ordered structure-of-arrays
+// scratch, and overlap tests run four at a time. Scratch only ever grows, so after the first few frames
+// suppression does not allocate.
+class NmsEngine {
+public:
+    NmsEngine(float iou_threshold, int topk = -1, float score_threshold = 0, float soft_sigma = 0.5f);
+
+    // Keeps only the topk highest-scoring candidates (-1 for all) before suppression
+    void setTopK(int topk);
+    void setIouThreshold(float threshold);
+
+    // Appends the surviving boxes to output. Returns -1 and leaves output untouched for an unknown type.
+    int run(const std::vector<FaceInfo>& input, std::vector<FaceInfo>& output, int type);
+
+    static const char* typeName(int type);
+    static int typeFromName(const char* name);  // hard, blending, fast or soft; -1 otherwise
+
+private:
+    void load(const std::vector<FaceInfo>& input);
+    int overlapMask(int i, int j) const;  // Bit k set when box i overlaps box j + k above iou_threshold
+    void hard(std::vector<FaceInfo>& output);
+    void blending(std::vector<FaceInfo>& output);
+    void fast(std::vector<FaceInfo>& output);
+    void soft(std::vector<FaceInfo>& output);
+
+    float iou_threshold;
+    int topk;
+    float score_threshold;  // Soft-NMS drops boxes whose decayed score falls to or below this
+    float soft_sigma;
+
+    int count;
+    std::vector<int> order;
+    // Boxes sorted by descending score, padded to a multiple of four lanes
+    std::vector<float> x1, y1, x2, y2, area, score;
+    std::vector<unsigned char> suppressed;
+    std::vector<int> cluster;
+};
+
+#endif // NMS_ENGINE_HPP
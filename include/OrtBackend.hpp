@@ -0,0 +1,72 @@
+#ifndef ORT_BACKEND_HPP
+#define ORT_BACKEND_HPP
+
+#ifdef USE_ONNXRUNTIME
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "onnxruntime_cxx_api.h"
+#include "DetectorBackend.hpp"
+
+class OrtBackend;
+
+// Input and outputs live in buffers owned by the session and are bound to the run through Ort::IoBinding, so
+// the preprocessor writes straight into the network input and the decoder reads the outputs where ONNX
+// Runtime wrote them. A graph with FaceDecodeNms fused in outputs only the final faces, which ONNX Runtime
+// allocates per run since their count varies.
+class OrtSession : public BackendSession {
+public:
+    int resize(int batch) override;
+    void writeInput(FusedPreprocessor& preprocessor, const uint8_t* src, int src_w, int src_h, int src_stride,
+                    PixelFormat format, int batch_index) override;
+    int run() override;
+    const float* scores() override;
+    const float* boxes() override;
+    int outputBatch() const override;
+    int fusedFaces(const float** rows) override;
+    size_t outputBytesCopied() const override;
+
+private:
+    friend class OrtBackend;
+
+    OrtSession(OrtBackend& owner, int input_width, int input_height, int anchor_count);
+
+    OrtBackend& owner;
+    Ort::IoBinding binding;
+    int in_w;
+    int in_h;
+    int anchor_count;
+    int batch = 0;
+    std::vector<float> input;
+    std::vector<float> scores_data;
+    std::vector<float> boxes_data;
+    std::vector<float> image_sizes;  // Fused graphs only, width and height per batch slot
+    Ort::Value faces{nullptr};
+};
+
+class OrtBackend : public DetectorBackend {
+public:
+    // Throws Ort::Exception when the model can't be loaded
+    OrtBackend(const std::string& model_path, int num_thread);
+
+    std::unique_ptr<BackendSession> createSession(int input_width, int input_height, int anchor_count) override;
+    const char* name() const override;
+
+private:
+    friend class OrtSession;
+
+    Ort::Env env;
+    // Ort::Session::Run is thread-safe, so every OrtSession runs on this one with its own binding
+    Ort::Session session;
+    Ort::MemoryInfo memory_info;
+    std::string input_name;
+    int fixed_batch;  // Batch dimension of the exported graph, 0 when it is dynamic
+    bool fused;       // Outputs "faces" from FaceDecodeNms instead of "scores" and "boxes"
+    int fixed_w;      // Input width of the exported graph, 0 when it is dynamic
+    int fixed_h;
+};
+
+#endif // USE_ONNXRUNTIME
+
+#endif // ORT_BACKEND_HPP
@@ -0,0 +1,72 @@
+#ifndef ROI_DETECTOR_HPP
+#define ROI_DETECTOR_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "UltraFace.hpp"
+
+// Tracking-mode detection: once a face is found, following frames only run a small-input session of the
+// same loaded model on a window around it. The window is the last face box grown by margin on every side and widened to the ROI
+// input's aspect ratio. It is cut from the frame as a view, so at a higher --frame-size the crop keeps
+// full-resolution pixels. A full-frame scan runs every full_scan_interval frames to pick up new people,
+// and straight away on the same frame whenever the window loses the face.
+class RoiDetector {
+public:
+    struct Stats {
+        uint64_t full_frames;     // Frames that ran a full scan, including re-acquisitions
+        uint64_t roi_frames;      // Frames served by the window alone
+        uint64_t losses;          // Windows that came back empty
+        double full_ms_avg;       // Detect cost of one full scan
+        double roi_ms_avg;        // Detect cost of one window
+        double reacquire_ms_avg;  // Loss to the next frame with a face again
+        double reacquire_ms_max;
+    };
+
+    RoiDetector(const std::string& model_path, cv::Size full_input, cv::Size roi_input, int full_scan_interval = 10,
+                int num_thread = 4, float score_threshold = 0.7, const std::string& backend = "");
+
+    // faces are in frame pixels either way
+    int detect(const cv::Mat& frame, std::vector<FaceInfo>& faces, PixelFormat format = PIXEL_FORMAT_BGR);
+
+    void setNmsType(int type);
+    void setMargin(float margin);  // Per side, as a fraction of the face size; default 1
+
+    bool isTracking() const;
+    cv::Rect lastWindow() const;  // Empty after a full scan
+    size_t getLastOutputBytesCopied() const;
+    Stats getStats() const;
+
+private:
+    cv::Rect window(const cv::Mat& frame) const;
+    int runFull(const cv::Mat& frame, std::vector<FaceInfo>& faces, PixelFormat format);
+    bool track(const std::vector<FaceInfo>& faces, size_t first);
+    static float detectMs(const UltraFace& detector);
+
+    UltraFace full;
+    UltraFace roi;  // Shares full's model, only its input size differs
+    cv::Size roi_input;
+    int full_scan_interval;
+    float margin;
+
+    bool tracking;
+    FaceInfo target;  // Largest face of the last frame, in frame pixels
+    int frames_since_full;
+    cv::Rect last_window;
+    UltraFace* last_detector;
+    int64_t lost_us;  // When the face was lost, 0 while it is held
+
+    std::atomic<uint64_t> full_frames;
+    std::atomic<uint64_t> roi_frames;
+    std::atomic<uint64_t> losses;
+    std::atomic<uint64_t> reacquisitions;
+    std::atomic<int64_t> full_us;
+    std::atomic<int64_t> roi_us;
+    std::atomic<int64_t> reacquire_us_total;
+    std::atomic<int64_t> reacquire_us_max;
+};
+
+#endif // ROI_DETECTOR_HPP
@@ -0,0 +1,78 @@
+#ifndef SIMD4_HPP
+#define SIMD4_HPP
+
+// Four-lane float helpers shared by the post-processing kernels. SIMD4_ENABLED is 1 on AArch64 NEON
+// and x86 SSE2; other targets use the kernels' scalar paths.
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD4_NEON 1
+#define SIMD4_ENABLED 1
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#define SIMD4_SSE 1
+#define SIMD4_ENABLED 1
+#else
+#define SIMD4_ENABLED 0
+#endif
+
+#if defined(SIMD4_NEON)
+typedef float32x4_t v4f;
+static inline v4f vset(float x) { return vdupq_n_f32(x); }
+static inline v4f vload(const float* p) { return vld1q_f32(p); }
+static inline void vstore(float* p, v4f a) { vst1q_f32(p, a); }
+static inline v4f vadd(v4f a, v4f b) { return vaddq_f32(a, b); }
+static inline v4f vsub(v4f a, v4f b) { return vsubq_f32(a, b); }
+static inline v4f vmul(v4f a, v4f b) { return vmulq_f32(a, b); }
+static inline v4f vdiv(v4f a, v4f b) { return vdivq_f32(a, b); }
+static inline v4f vmin(v4f a, v4f b) { return vminq_f32(a, b); }
+static inline v4f vmax(v4f a, v4f b) { return vmaxq_f32(a, b); }
+// Bit k set when lane k of a is greater than lane k of b
+static inline int vgtmask(v4f a, v4f b) {
+    uint32x4_t gt = vcgtq_f32(a, b);
+    return (vgetq_lane_u32(gt, 0) & 1) | (vgetq_lane_u32(gt, 1) & 2) | (vgetq_lane_u32(gt, 2) & 4) |
+           (vgetq_lane_u32(gt, 3) & 8);
+}
+// Rounds to the nearest integer, returning it as a float and as 2^n
+static inline v4f vround(v4f a, v4f* pow2n) {
+    int32x4_t n = vcvtnq_s32_f32(a);
+    *pow2n = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(127)), 23));
+    return vcvtq_f32_s32(n);
+}
+#elif defined(SIMD4_SSE)
+typedef __m128 v4f;
+static inline v4f vset(float x) { return _mm_set1_ps(x); }
+static inline v4f vload(const float* p) { return _mm_loadu_ps(p); }
+static inline void vstore(float* p, v4f a) { _mm_storeu_ps(p, a); }
+static inline v4f vadd(v4f a, v4f b) { return _mm_add_ps(a, b); }
+static inline v4f vsub(v4f a, v4f b) { return _mm_sub_ps(a, b); }
+static inline v4f vmul(v4f a, v4f b) { return _mm_mul_ps(a, b); }
+static inline v4f vdiv(v4f a, v4f b) { return _mm_div_ps(a, b); }
+static inline v4f vmin(v4f a, v4f b) { return _mm_min_ps(a, b); }
+static inline v4f vmax(v4f a, v4f b) { return _mm_max_ps(a, b); }
+static inline int vgtmask(v4f a, v4f b) { return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+static inline v4f vround(v4f a, v4f* pow2n) {
+    __m128i n = _mm_cvtps_epi32(a);
+    *pow2n = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+    return _mm_cvtepi32_ps(n);
+}
+#endif
+
+#if SIMD4_ENABLED
+// Cephes-style exp: x = n ln2 + r with |r| <= ln2 / 2, degree 5 polynomial for e^r, 2^n via the exponent bits
+static inline v4f vexp(v4f x) {
+    x = vmin(vmax(x, vset(-87.3f)), vset(88.3f));
+    v4f pow2n;
+    v4f n = vround(vmul(x, vset(1.44269504088896341f)), &pow2n);
+    v4f r = vsub(vsub(x, vmul(n, vset(0.693359375f))), vmul(n, vset(-2.12194440e-4f)));
+    v4f p = vset(1.9875691500e-4f);
+    p = vadd(vmul(p, r), vset(1.3981999507e-3f));
+    p = vadd(vmul(p, r), vset(8.3334519073e-3f));
+    p = vadd(vmul(p, r), vset(4.1665795894e-2f));
+    p = vadd(vmul(p, r), vset(1.6666665459e-1f));
+    p = vadd(vmul(p, r), vset(5.0000001201e-1f));
+    p = vadd(vadd(vmul(p, vmul(r, r)), r), vset(1.0f));
+    return vmul(p, pow2n);
+}
+#endif
+
+#endif // SIMD4_HPP
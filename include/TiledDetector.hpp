@@ -0,0 +1,69 @@
+#ifndef TILED_DETECTOR_HPP
+#define TILED_DETECTOR_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "DetectorPool.hpp"
+#include "NmsEngine.hpp"
+#include "UltraFace.hpp"
+
+// Detection on a high-resolution frame split into overlapping tiles the size of the network input, so each
+// tile is inferred at full resolution and faces too small to survive squashing the whole frame keep their
+// pixels. The grid follows from the frame size: as many tiles per row and column as it takes for neighbours
+// to share at least overlap of a tile. Tiles are views of the frame. They run as one batch, or spread over a
+// DetectorPool when sessions > 1. By default the whole frame runs alongside them, which catches faces too
+// large for one tile. Boxes are mapped back to frame pixels and merged with one NMS pass across tiles. A box
+// cut off by an inner tile edge is dropped when another tile holds that region whole.
+class TiledDetector {
+public:
+    struct Stats {
+        uint64_t frames;
+        int tiles;              // Detector inputs per frame, including the whole-frame pass
+        double detect_ms_avg;   // Wall time of one frame, all tiles and the merge
+        double faces_avg;       // After the merge
+    };
+
+    // overlap is the least fraction of a tile shared with its neighbour, 0 to below 1
+    TiledDetector(const std::string& model_path, cv::Size input, float overlap = 0.2f, int sessions = 1,
+                  int num_thread = 4, float score_threshold = 0.7, const std::string& backend = "");
+
+    // faces are in frame pixels
+    int detect(const cv::Mat& frame, std::vector<FaceInfo>& faces, PixelFormat format = PIXEL_FORMAT_BGR);
+
+    void setNmsType(int type);     // Both within each tile and across tiles
+    void setFullFrame(bool enable);
+
+    // Row-major tiles covering frame; a frame no larger than the input is one tile
+    std::vector<cv::Rect> tileRects(cv::Size frame) const;
+    size_t getLastOutputBytesCopied() const;  // Batched mode only; pooled sessions don't report it
+    Stats getStats() const;
+
+private:
+    int detectTiles(const std::vector<cv::Mat>& images, PixelFormat format);
+
+    static std::vector<int> tileOffsets(int length, int tile, float overlap);
+    static bool heldWhole(const std::vector<cv::Rect>& tiles, size_t except, const FaceInfo& face);
+
+    UltraFace detector;
+    std::unique_ptr<DetectorPool> pool;
+    cv::Size input;
+    float overlap;
+    bool full_frame;
+    int nms_type;
+    NmsEngine merge_engine;
+
+    std::vector<cv::Mat> images;
+    std::vector<std::vector<FaceInfo>> tile_faces;
+    std::vector<FaceInfo> candidates;
+
+    std::atomic<uint64_t> frames;
+    std::atomic<int> tiles;
+    std::atomic<int64_t> detect_us;
+    std::atomic<uint64_t> faces_total;
+};
+
+#endif // TILED_DETECTOR_HPP
@@ -6,62 +6,129 @@
 
 #pragma once
 
-#include "Interpreter.hpp"
-
-#include "MNNDefine.h"
-#include "Tensor.hpp"
-#include "ImageProcess.hpp"
+#include "CamFrame.hpp"
+#include "DetectorBackend.hpp"
+#include "FusedPreprocessor.hpp"
+#include "AnchorTable.hpp"
+#include "BoxDecoder.hpp"
+#include "FaceInfo.hpp"
+#include "NmsEngine.hpp"
 #include <opencv2/opencv.hpp>
 #include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <memory>
+#include <atomic>
 #include <chrono>
 
-#define num_featuremap 4
-#define hard_nms 1
-#define blending_nms 2 /* mix nms was been proposaled in paper blaze face, aims to minimize the temporal jitter*/
-typedef struct FaceInfo {
-    float x1;
-    float y1;
-    float x2;
-    float y2;
-    float score;
+typedef struct DetectTiming {
+    float pre_ms;    // fused resize/normalize into the input tensor
+    float infer_ms;  // runSession
+    float post_ms;   // output read, generateBBox, nms
+} DetectTiming;
+
+class UltraFace;
+
+// Everything a detect() call writes: a backend session with its input and outputs, plus pre/post-processing
+// scratch and the last call's timing. Give each thread or camera its own; it must not outlive its UltraFace.
+class UltraFaceContext {
+public:
+    const DetectTiming &getLastTiming() const;
+
+    size_t getLastOutputBytesCopied() const;  // 0 when the outputs were read in place
+
+private:
+    friend class UltraFace;
+
+    UltraFaceContext(std::unique_ptr<BackendSession> session, const float mean[3], const float norm[3],
+                     const NmsEngine &nms_engine);
+
+    std::unique_ptr<BackendSession> session;
+    size_t output_bytes_copied = 0;
 
-} FaceInfo;
+    FusedPreprocessor preprocessor;
+    std::vector<int> candidates;  // Anchor indices above score_threshold, reused across frames
+    std::vector<FaceInfo> bbox_collection;
+    std::vector<cv::Size> image_sizes;  // Per batch slot, from the last preprocess()
+    NmsEngine nms_engine;
+    DetectTiming last_timing = {0, 0, 0};
+};
 
+// The loaded model plus everything derived from the input size. Read-only once constructed, so one
+// instance serves any number of threads, each detecting through its own UltraFaceContext.
 class UltraFace {
 public:
-    UltraFace(const std::string &mnn_path,
+    // backend is "mnn" or "onnx"; empty picks it from the model file extension. ONNX models with the
+    // post-processing fused in (tools/fuse_postprocess.py) apply the thresholds and NMS type they were exported with.
+    UltraFace(const std::string &model_path,
               int input_width, int input_length, int num_thread_ = 4, float score_threshold_ = 0.7, float iou_threshold_ = 0.3,
-              int topk_ = -1);
+              int topk_ = -1, const std::string &backend = "");
+
+    // Another input size on model's loaded network, with its thresholds: only sessions and anchors are new.
+    // The graph must accept the size (MNN resizes any fully convolutional model; ONNX exports are often fixed).
+    UltraFace(const UltraFace &model, int input_width, int input_length);
 
     ~UltraFace();
 
-    int detect(cv::Mat &img, std::vector<FaceInfo> &face_list);
+    // A new session on the shared model, warmed up. Safe to call from any thread. nullptr if the model failed to
+    // load or the session could not be created or planned.
+    std::unique_ptr<UltraFaceContext> createContext();
+
+    // Reentrant: concurrent calls are safe as long as each uses a different context
+    int detect(UltraFaceContext &context, const cv::Mat &img, std::vector<FaceInfo> &face_list,
+               PixelFormat format = PIXEL_FORMAT_BGR) const;
+
+    // Single-caller shorthand on a built-in context
+    int detect(const cv::Mat &img, std::vector<FaceInfo> &face_list, PixelFormat format = PIXEL_FORMAT_BGR);
+
+    // All images through one N-batch session run; face_lists[i] receives the faces of images[i]. Models
+    // exported with a fixed batch of 1 are detected image by image instead.
+    int detectBatch(UltraFaceContext &context, const std::vector<cv::Mat> &images,
+                    std::vector<std::vector<FaceInfo>> &face_lists, PixelFormat format = PIXEL_FORMAT_BGR) const;
+
+    int detectBatch(const std::vector<cv::Mat> &images, std::vector<std::vector<FaceInfo>> &face_lists,
+                    PixelFormat format = PIXEL_FORMAT_BGR);
+
+    // detect() split into its stages, for callers that overlap them across contexts. Each stage only touches
+    // its context; postprocess() reads the outputs of the last infer() and the sizes from the last preprocess().
+    int preprocess(UltraFaceContext &context, const cv::Mat *images, int count, PixelFormat format) const;
+
+    int infer(UltraFaceContext &context) const;
+
+    int postprocess(UltraFaceContext &context, std::vector<FaceInfo> *face_lists) const;
+
+    const DetectTiming &getLastTiming() const;
+
+    size_t getLastOutputBytesCopied() const;
+
+    void setNmsType(int type);  // hard_nms, blending_nms (default), fast_nms or soft_nms; set before detecting
+
+    void setBilinear(bool enable);  // Bilinear (default) or nearest-neighbour input resizing; set before detecting
+
+    const char *backendName() const;
 
 private:
-    void generateBBox(std::vector<FaceInfo> &bbox_collection, MNN::Tensor *scores, MNN::Tensor *boxes);
+    int run(UltraFaceContext &context, const cv::Mat *images, int count, std::vector<FaceInfo> *face_lists,
+            PixelFormat format) const;
 
-    void nms(std::vector<FaceInfo> &input, std::vector<FaceInfo> &output, int type = blending_nms);
+    void generateBBox(UltraFaceContext &context, const float *scores, const float *boxes, int image_w,
+                      int image_h) const;
 
 private:
 
-    std::shared_ptr<MNN::Interpreter> ultraface_interpreter;
-    MNN::Session *ultraface_session = nullptr;
-    MNN::Tensor *input_tensor = nullptr;
+    std::shared_ptr<DetectorBackend> backend;  // Shared by every UltraFace made from the same model
+    std::unique_ptr<UltraFaceContext> default_context;
+    mutable std::atomic<bool> batch_folded;  // The graph reshapes to batch 1, so batched outputs can't be split
 
     int num_thread;
-    int image_w;
-    int image_h;
 
     int in_w;
     int in_h;
-    int num_anchors;
 
     float score_threshold;
     float iou_threshold;
+    int topk;
 
 
     const float mean_vals[3] = {127, 127, 127};
@@ -69,17 +136,10 @@ private:
 
     const float center_variance = 0.1;
     const float size_variance = 0.2;
-    const std::vector<std::vector<float>> min_boxes = {
-            {10.0f,  16.0f,  24.0f},
-            {32.0f,  48.0f},
-            {64.0f,  96.0f},
-            {128.0f, 192.0f, 256.0f}};
-    const std::vector<float> strides = {8.0, 16.0, 32.0, 64.0};
-    std::vector<std::vector<float>> featuremap_size;
-    std::vector<std::vector<float>> shrinkage_size;
-    std::vector<int> w_h_list;
-
-    std::vector<std::vector<float>> priors = {};
+    AnchorTable anchors;
+    BoxDecoder decoder;
+    int nms_type = blending_nms;
+    bool bilinear = true;
 };
 
 #endif /* UltraFace_hpp */
@@ -0,0 +1,62 @@
+#ifndef V4L2_FRAME_SOURCE_HPP
+#define V4L2_FRAME_SOURCE_HPP
+
+#include <sys/types.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "FrameSource.hpp"
+
+// System calls used against the device. Defaults to libc; a fake set lets the source run
+// against an ioctl shim instead of a real /dev/videoN.
+struct V4l2DeviceOps {
+    int (*open)(const char* path, int flags);
+    int (*close)(int fd);
+    int (*ioctl)(int fd, unsigned long request, void* arg);
+    void* (*mmap)(void* addr, size_t length, int prot, int flags, int fd, off_t offset);
+    int (*munmap)(void* addr, size_t length);
+    int (*poll)(int fd, int timeout_ms);  // > 0 when a buffer is ready
+
+    static const V4l2DeviceOps& system();
+};
+
+// Native capture from /dev/videoN with V4L2 streaming I/O: kernel buffers are mmap'd once and
+// cycled with VIDIOC_DQBUF/VIDIOC_QBUF, so frames reach the callback without any copy.
+// MJPEG is preferred; YUYV is used when the camera cannot compress.
+class V4l2FrameSource : public FrameSource {
+public:
+    V4l2FrameSource(const std::string& device, int width, int height, int fps = 30, int buffer_count = 4,
+                    const V4l2DeviceOps& ops = V4l2DeviceOps::system());
+    ~V4l2FrameSource();
+
+    bool run(const std::atomic<bool>& running, const FrameCallback& callback) override;
+
+    FrameEncoding getEncoding() const;
+
+private:
+    struct MappedBuffer {
+        void* start;
+        size_t length;
+    };
+
+    bool openDevice();
+    bool setFormat();
+    bool startStreaming();
+    void closeDevice();
+    int xioctl(unsigned long request, void* arg);
+
+    std::string device;
+    int width;
+    int height;
+    int stride;
+    int fps;
+    int buffer_count;
+    const V4l2DeviceOps& ops;
+
+    int fd;
+    FrameEncoding encoding;
+    std::vector<MappedBuffer> buffers;
+    bool streaming;
+};
+
+#endif // V4L2_FRAME_SOURCE_HPP
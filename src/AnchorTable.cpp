@@ -0,0 +1,99 @@
+#include "AnchorTable.hpp"
+
+static constexpr int num_levels = 4;
+static constexpr int strides[num_levels] = {8, 16, 32, 64};
+static constexpr int min_box_count[num_levels] = {3, 2, 2, 3};
+static constexpr float min_boxes[num_levels][3] = {
+        {10.0f,  16.0f,  24.0f},
+        {32.0f,  48.0f,  0},
+        {64.0f,  96.0f,  0},
+        {128.0f, 192.0f, 256.0f}};
+
+static constexpr float clip1(float x) {
+    return x < 0 ? 0 : (x > 1 ? 1 : x);
+}
+
+static constexpr int anchorCount(int in_w, int in_h) {
+    int total = 0;
+    for (int level = 0; level < num_levels; level++) {
+        int fm_w = (in_w + strides[level] - 1) / strides[level];
+        int fm_h = (in_h + strides[level] - 1) / strides[level];
+        total += fm_w * fm_h * min_box_count[level];
+    }
+    return total;
+}
+
+// Same arithmetic, and so the same floats, as the original nested-vector generator:
+// centers are computed in double from a float scale, sizes in float
+static constexpr void generateAnchors(int in_w, int in_h, float* cx, float* cy, float* w, float* h) {
+    int n = 0;
+    for (int level = 0; level < num_levels; level++) {
+        int fm_w = (in_w + strides[level] - 1) / strides[level];
+        int fm_h = (in_h + strides[level] - 1) / strides[level];
+        float scale_w = in_w / (float) strides[level];
+        float scale_h = in_h / (float) strides[level];
+        for (int j = 0; j < fm_h; j++) {
+            for (int i = 0; i < fm_w; i++) {
+                float x_center = (i + 0.5) / scale_w;
+                float y_center = (j + 0.5) / scale_h;
+                for (int k = 0; k < min_box_count[level]; k++) {
+                    cx[n] = clip1(x_center);
+                    cy[n] = clip1(y_center);
+                    w[n] = clip1(min_boxes[level][k] / in_w);
+                    h[n] = clip1(min_boxes[level][k] / in_h);
+                    n++;
+                }
+            }
+        }
+    }
+}
+
+template<int W, int H>
+struct StaticAnchors {
+    static constexpr int count = anchorCount(W, H);
+    float cx[count] = {};
+    float cy[count] = {};
+    float w[count] = {};
+    float h[count] = {};
+
+    constexpr StaticAnchors() {
+        generateAnchors(W, H, cx, cy, w, h);
+    }
+};
+
+static constexpr StaticAnchors<320, 240> anchors_320x240;
+static constexpr StaticAnchors<640, 480> anchors_640x480;
+
+static_assert(StaticAnchors<320, 240>::count == 4420, "UltraFace-320 has 4420 anchors");
+
+AnchorTable::AnchorTable(int input_width, int input_height) {
+    if (input_width == 320 && input_height == 240) {
+        cx = anchors_320x240.cx;
+        cy = anchors_320x240.cy;
+        w = anchors_320x240.w;
+        h = anchors_320x240.h;
+        count = anchors_320x240.count;
+        return;
+    }
+    if (input_width == 640 && input_height == 480) {
+        cx = anchors_640x480.cx;
+        cy = anchors_640x480.cy;
+        w = anchors_640x480.w;
+        h = anchors_640x480.h;
+        count = anchors_640x480.count;
+        return;
+    }
+
+    count = anchorCount(input_width, input_height);
+    storage.resize(count * 4);
+    float* base = storage.data();
+    generateAnchors(input_width, input_height, base, base + count, base + count * 2, base + count * 3);
+    cx = base;
+    cy = base + count;
+    w = base + count * 2;
+    h = base + count * 3;
+}
+
+AnchorTable::AnchorTable(const float* planes, int count)
+    : cx(planes), cy(planes + count), w(planes + count * 2), h(planes + count * 3), count(count) {
+}
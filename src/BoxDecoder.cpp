@@ -0,0 +1,175 @@
+#include "BoxDecoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Simd4.hpp"
+
+typedef void (*ScanKernel)(const float* scores, int count, float threshold, std::vector<int>& candidates);
+
+static void scanScalar(const float* scores, int count, float threshold, std::vector<int>& candidates, int start) {
+    for (int i = start; i < count; i++) {
+        if (scores[i * 2 + 1] > threshold) {
+            candidates.push_back(i);
+        }
+    }
+}
+
+#if !SIMD4_ENABLED
+static void scanKernelScalar(const float* scores, int count, float threshold, std::vector<int>& candidates) {
+    scanScalar(scores, count, threshold, candidates, 0);
+}
+#endif
+
+static inline void pushMask(unsigned mask, int base, std::vector<int>& candidates) {
+    while (mask) {
+        candidates.push_back(base + __builtin_ctz(mask));
+        mask &= mask - 1;
+    }
+}
+
+#ifdef SIMD4_NEON
+static void scanKernelNeon(const float* scores, int count, float threshold, std::vector<int>& candidates) {
+    const float32x4_t t = vdupq_n_f32(threshold);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4x2_t pairs = vld2q_f32(scores + i * 2);  // val[1] holds the face scores of 4 anchors
+        uint32x4_t above = vcgtq_f32(pairs.val[1], t);
+        if (vmaxvq_u32(above) == 0) {
+            continue;
+        }
+        unsigned mask = (vgetq_lane_u32(above, 0) & 1) | (vgetq_lane_u32(above, 1) & 2) |
+                        (vgetq_lane_u32(above, 2) & 4) | (vgetq_lane_u32(above, 3) & 8);
+        pushMask(mask, i, candidates);
+    }
+    scanScalar(scores, count, threshold, candidates, i);
+}
+#endif
+
+#ifdef SIMD4_SSE
+static void scanKernelSse2(const float* scores, int count, float threshold, std::vector<int>& candidates) {
+    const __m128 t = _mm_set1_ps(threshold);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 a = _mm_loadu_ps(scores + i * 2);
+        __m128 b = _mm_loadu_ps(scores + i * 2 + 4);
+        __m128 face = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        pushMask(_mm_movemask_ps(_mm_cmpgt_ps(face, t)), i, candidates);
+    }
+    scanScalar(scores, count, threshold, candidates, i);
+}
+
+__attribute__((target("avx2")))
+static void scanKernelAvx2(const float* scores, int count, float threshold, std::vector<int>& candidates) {
+    const __m256 t = _mm256_set1_ps(threshold);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 a = _mm256_loadu_ps(scores + i * 2);
+        __m256 b = _mm256_loadu_ps(scores + i * 2 + 8);
+        // Per 128-bit lane this yields anchors {0,1,4,5 | 2,3,6,7}; the 64-bit permute restores order
+        __m256 face = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        face = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(face), _MM_SHUFFLE(3, 1, 2, 0)));
+        pushMask(_mm256_movemask_ps(_mm256_cmp_ps(face, t, _CMP_GT_OQ)), i, candidates);
+    }
+    scanScalar(scores, count, threshold, candidates, i);
+}
+#endif
+
+static ScanKernel selectScan(const char** name) {
+#if defined(SIMD4_NEON)
+    *name = "neon";
+    return scanKernelNeon;
+#elif defined(SIMD4_SSE)
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return scanKernelAvx2;
+    }
+    *name = "sse2";
+    return scanKernelSse2;
+#else
+    *name = "scalar";
+    return scanKernelScalar;
+#endif
+}
+
+static const char* kernel_name = nullptr;
+static const ScanKernel scan_kernel = selectScan(&kernel_name);
+
+#if SIMD4_ENABLED
+static inline v4f clip1(v4f x) {
+    return vmin(vmax(x, vset(0)), vset(1));
+}
+#endif
+
+BoxDecoder::BoxDecoder(const AnchorTable& anchors, float center_variance, float size_variance)
+    : anchors(anchors), center_variance(center_variance), size_variance(size_variance) {
+}
+
+const char* BoxDecoder::kernelName() {
+    return kernel_name;
+}
+
+void BoxDecoder::scan(const float* scores, float threshold, std::vector<int>& candidates) const {
+    scan_kernel(scores, anchors.size(), threshold, candidates);
+}
+
+void BoxDecoder::decode(const float* scores, const float* boxes, const std::vector<int>& candidates, int image_w,
+                        int image_h, std::vector<FaceInfo>& faces) const {
+    int count = candidates.size();
+#if SIMD4_ENABLED
+    const v4f cv = vset(center_variance);
+    const v4f sv = vset(size_variance);
+    const v4f half = vset(0.5f);
+    const v4f img_w = vset((float) image_w);
+    const v4f img_h = vset((float) image_h);
+    for (int base = 0; base < count; base += 4) {
+        // Gather up to four candidates into lanes, repeating the last one to fill a short tail
+        float dx[4], dy[4], dw[4], dh[4], acx[4], acy[4], aw[4], ah[4], score[4];
+        for (int lane = 0; lane < 4; lane++) {
+            int i = candidates[base + lane < count ? base + lane : count - 1];
+            const float* loc = boxes + i * 4;
+            dx[lane] = loc[0];
+            dy[lane] = loc[1];
+            dw[lane] = loc[2];
+            dh[lane] = loc[3];
+            acx[lane] = anchors.cx[i];
+            acy[lane] = anchors.cy[i];
+            aw[lane] = anchors.w[i];
+            ah[lane] = anchors.h[i];
+            score[lane] = scores[i * 2 + 1];
+        }
+        v4f w_a = vload(aw);
+        v4f h_a = vload(ah);
+        v4f x_center = vadd(vmul(vmul(vload(dx), cv), w_a), vload(acx));
+        v4f y_center = vadd(vmul(vmul(vload(dy), cv), h_a), vload(acy));
+        v4f half_w = vmul(vmul(vexp(vmul(vload(dw), sv)), w_a), half);
+        v4f half_h = vmul(vmul(vexp(vmul(vload(dh), sv)), h_a), half);
+
+        float x1[4], y1[4], x2[4], y2[4];
+        vstore(x1, vmul(clip1(vsub(x_center, half_w)), img_w));
+        vstore(y1, vmul(clip1(vsub(y_center, half_h)), img_h));
+        vstore(x2, vmul(clip1(vadd(x_center, half_w)), img_w));
+        vstore(y2, vmul(clip1(vadd(y_center, half_h)), img_h));
+        vstore(score, clip1(vload(score)));
+
+        for (int lane = 0; lane < 4 && base + lane < count; lane++) {
+            faces.push_back({x1[lane], y1[lane], x2[lane], y2[lane], score[lane]});
+        }
+    }
+#else
+    for (int n = 0; n < count; n++) {
+        int i = candidates[n];
+        const float* loc = boxes + i * 4;
+        float x_center = loc[0] * center_variance * anchors.w[i] + anchors.cx[i];
+        float y_center = loc[1] * center_variance * anchors.h[i] + anchors.cy[i];
+        float half_w = std::exp(loc[2] * size_variance) * anchors.w[i] * 0.5f;
+        float half_h = std::exp(loc[3] * size_variance) * anchors.h[i] * 0.5f;
+        float score = scores[i * 2 + 1];
+        faces.push_back({std::min(std::max(x_center - half_w, 0.0f), 1.0f) * image_w,
+                         std::min(std::max(y_center - half_h, 0.0f), 1.0f) * image_h,
+                         std::min(std::max(x_center + half_w, 0.0f), 1.0f) * image_w,
+                         std::min(std::max(y_center + half_h, 0.0f), 1.0f) * image_h,
+                         std::min(score, 1.0f)});
+    }
+#endif
+}
@@ -0,0 +1,114 @@
+#include "DecodePool.hpp"
+
+#include <cstring>
+#include <iostream>
+
+DecodePool::DecodePool(int workers, JpegDecoderBackend backend, int out_width, int out_height,
+                       PublishCallback publish)
+    : out_w(out_width), out_h(out_height), publish(std::move(publish)), stopping(false), next_sequence(1),
+      last_published(0), stats{0, 0, 0, 0, 0} {
+    // One job per worker plus one waiting is all that can ever be in flight
+    for (int i = 0; i < workers + 1; i++) {
+        free_jobs.emplace_back(new Job());
+    }
+    for (int i = 0; i < workers; i++) {
+        converters.emplace_back(new FrameConverter(backend, out_w, out_h));
+    }
+    for (int i = 0; i < workers; i++) {
+        threads.emplace_back(&DecodePool::workerLoop, this, i);
+    }
+}
+
+DecodePool::~DecodePool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void DecodePool::submit(const CapturedFrame& frame, int64_t timestamp_us) {
+    std::unique_ptr<Job> job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.submitted++;
+        if (!free_jobs.empty()) {
+            job = std::move(free_jobs.back());
+            free_jobs.pop_back();
+        } else {
+            // Everyone is busy: the oldest waiting frame is out of date, reuse its job
+            job = std::move(waiting.front());
+            waiting.pop_front();
+            stats.dropped_waiting++;
+        }
+        job->sequence = next_sequence++;
+    }
+
+    // The source buffer is only valid during its callback, so the compressed frame is copied once here
+    if (job->data.size() < frame.size) {
+        job->data.resize(frame.size + frame.size / 4);
+    }
+    memcpy(job->data.data(), frame.data, frame.size);
+    job->frame = frame;
+    job->frame.data = job->data.data();
+    job->frame.bytes_copied += frame.size;
+    job->timestamp_us = timestamp_us;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        waiting.push_back(std::move(job));
+    }
+    job_ready.notify_one();
+}
+
+DecodePool::Stats DecodePool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+int DecodePool::getWorkerCount() const {
+    return (int) threads.size();
+}
+
+void DecodePool::workerLoop(int index) {
+    FrameConverter& converter = *converters[index];
+    cv::Mat decoded(out_h, out_w, CV_8UC3);
+
+    while (true) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_ready.wait(lock, [this] { return stopping || !waiting.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(waiting.front());
+            waiting.pop_front();
+        }
+
+        PixelFormat format;
+        bool decoded_ok = converter.convert(job->frame, decoded, format);
+        bool published = false;
+        if (decoded_ok) {
+            std::lock_guard<std::mutex> lock(publish_mutex);
+            if (job->sequence > last_published) {
+                last_published = job->sequence;
+                publish(decoded, format, job->timestamp_us, job->frame.bytes_copied);
+                published = true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!decoded_ok) {
+            stats.failed++;
+        } else if (published) {
+            stats.published++;
+        } else {
+            stats.dropped_late++;
+        }
+        free_jobs.push_back(std::move(job));
+    }
+}
@@ -0,0 +1,145 @@
+#include "DetectionPipeline.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include "FrameRing.hpp"
+
+DetectionPipeline::DetectionPipeline(UltraFace& detector, FrameProvider provider, ResultCallback done)
+    : detector(detector), provider(std::move(provider)), done(std::move(done)), running(false), frames(0),
+      failed(0), latency_us_total(0), latency_us_max(0), start_us(0) {
+    for (auto &slot : slots) {
+        slot.context = detector.createContext();
+        slot.timestamp_us = 0;
+        slot.inferred = false;
+    }
+    for (auto &total : stage_us_total) {
+        total = 0;
+    }
+}
+
+DetectionPipeline::~DetectionPipeline() {
+    stop();
+}
+
+bool DetectionPipeline::start() {
+    if (running) {
+        return true;
+    }
+    for (auto &slot : slots) {
+        if (!slot.context) {
+            std::cerr << "Detection pipeline has no session for every stage, not starting." << std::endl;
+            return false;
+        }
+    }
+    for (int i = 0; i < PIPELINE_SLOTS; i++) {
+        free_slots.push(i);
+    }
+    start_us = FrameRing::now();
+    running = true;
+    threads.emplace_back(&DetectionPipeline::preprocessLoop, this);
+    threads.emplace_back(&DetectionPipeline::inferLoop, this);
+    threads.emplace_back(&DetectionPipeline::postprocessLoop, this);
+    return true;
+}
+
+void DetectionPipeline::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+    // Every stage has exited, so draining from this thread is safe
+    int slot;
+    while (free_slots.pop(slot) || ready_slots.pop(slot) || output_slots.pop(slot)) {
+    }
+}
+
+DetectionPipeline::Stats DetectionPipeline::getStats() const {
+    Stats stats;
+    stats.frames = frames;
+    stats.failed = failed;
+    double seconds = std::max<int64_t>(FrameRing::now() - start_us, 1) / 1e6;
+    stats.fps = stats.frames / seconds;
+    stats.latency_ms_avg = stats.frames ? latency_us_total / 1000.0 / stats.frames : 0;
+    stats.latency_ms_max = latency_us_max / 1000.0;
+    for (int i = 0; i < 3; i++) {
+        stats.stage_ms[i] = stats.frames ? stage_us_total[i] / 1000.0 / stats.frames : 0;
+    }
+    return stats;
+}
+
+// Stages run at frame rate, so an empty queue is met with a short sleep rather than a condition variable
+bool DetectionPipeline::waitPop(SpscQueue<int, PIPELINE_SLOTS>& queue, int& slot) {
+    int spins = 0;
+    while (running) {
+        if (queue.pop(slot)) {
+            return true;
+        }
+        if (++spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    return false;
+}
+
+void DetectionPipeline::preprocessLoop() {
+    cv::Mat frame;
+    PixelFormat format;
+    int64_t timestamp_us;
+    int slot;
+    while (waitPop(free_slots, slot)) {
+        // The slot is held until a frame has been written into it
+        bool filled = false;
+        while (running && !filled) {
+            if (!provider(frame, format, timestamp_us)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            filled = detector.preprocess(*slots[slot].context, &frame, 1, format) == 0;
+        }
+        if (!filled) {
+            return;
+        }
+        slots[slot].timestamp_us = timestamp_us;
+        ready_slots.push(slot);
+    }
+}
+
+void DetectionPipeline::inferLoop() {
+    int slot;
+    while (waitPop(ready_slots, slot)) {
+        slots[slot].inferred = detector.infer(*slots[slot].context) == 0;
+        output_slots.push(slot);
+    }
+}
+
+void DetectionPipeline::postprocessLoop() {
+    std::vector<FaceInfo> faces;
+    int slot;
+    while (waitPop(output_slots, slot)) {
+        UltraFaceContext& context = *slots[slot].context;
+        faces.clear();
+        if (!slots[slot].inferred || detector.postprocess(context, &faces) != 0) {
+            failed++;
+            free_slots.push(slot);
+            continue;
+        }
+        const DetectTiming& timing = context.getLastTiming();
+        done(slots[slot].timestamp_us, faces, timing);
+
+        int64_t latency = FrameRing::now() - slots[slot].timestamp_us;
+        stage_us_total[0] += (int64_t) (timing.pre_ms * 1000);
+        stage_us_total[1] += (int64_t) (timing.infer_ms * 1000);
+        stage_us_total[2] += (int64_t) (timing.post_ms * 1000);
+        latency_us_total += latency;
+        latency_us_max = std::max<int64_t>(latency_us_max, latency);
+        frames++;
+
+        free_slots.push(slot);
+    }
+}
@@ -0,0 +1,37 @@
+#include "DetectorBackend.hpp"
+
+#include <iostream>
+#include "MnnBackend.hpp"
+#include "OrtBackend.hpp"
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::unique_ptr<DetectorBackend> DetectorBackend::create(const std::string& model_path, const std::string& type,
+                                                         int num_thread) {
+    std::string backend = type.empty() ? (endsWith(model_path, ".onnx") ? "onnx" : "mnn") : type;
+    if (backend == "mnn") {
+        MNN::Interpreter* interpreter = MNN::Interpreter::createFromFile(model_path.c_str());
+        if (!interpreter) {
+            std::cerr << "Failed to load MNN model " << model_path << std::endl;
+            return nullptr;
+        }
+        return std::unique_ptr<DetectorBackend>(new MnnBackend(interpreter, num_thread));
+    }
+    if (backend == "onnx") {
+#ifdef USE_ONNXRUNTIME
+        try {
+            return std::unique_ptr<DetectorBackend>(new OrtBackend(model_path, num_thread));
+        } catch (const Ort::Exception& e) {
+            std::cerr << "Failed to load ONNX model " << model_path << ": " << e.what() << std::endl;
+            return nullptr;
+        }
+#else
+        std::cerr << "Built without ONNX Runtime, rebuild with ONNXRUNTIME=1" << std::endl;
+        return nullptr;
+#endif
+    }
+    std::cerr << "Unknown detector backend " << backend << ", expected mnn or onnx" << std::endl;
+    return nullptr;
+}
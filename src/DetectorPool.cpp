@@ -0,0 +1,172 @@
+#include "DetectorPool.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include "FrameRing.hpp"
+
+DetectorPool::DetectorPool(UltraFace& detector, int sessions)
+    : detector(detector), pending(0), next_session(0), stopping(false), submitted(0), completed(0),
+      queue_us_total(0), queue_us_max(0) {
+    // Sessions are created up front, all from the same loaded model, so the model file is read once
+    for (int i = 0; i < sessions; i++) {
+        std::unique_ptr<Session> session(new Session());
+        session->context = detector.createContext();
+        if (!session->context) {
+            std::cerr << "Failed to create detector session " << i << ", the pool runs without it." << std::endl;
+            continue;
+        }
+        this->sessions.push_back(std::move(session));
+    }
+    if (this->sessions.empty()) {
+        std::cerr << "No detector session could be created, every frame will fail." << std::endl;
+    }
+    start_us = FrameRing::now();
+    for (int i = 0; i < (int) this->sessions.size(); i++) {
+        threads.emplace_back(&DetectorPool::workerLoop, this, i);
+    }
+}
+
+DetectorPool::~DetectorPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    // Frames still queued are answered rather than silently lost
+    std::vector<FaceInfo> none;
+    for (auto &session : sessions) {
+        for (auto &job : session->queue) {
+            job.done(-1, none);
+        }
+    }
+}
+
+void DetectorPool::submit(const cv::Mat& frame, PixelFormat format, ResultCallback done) {
+    if (sessions.empty()) {
+        done(-1, std::vector<FaceInfo>());
+        return;
+    }
+    Session& session = *sessions[next_session++ % sessions.size()];
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.queue.push_back({frame, format, std::move(done), FrameRing::now()});
+    }
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        submitted++;
+    }
+    {
+        // Taking wake_mutex orders the increment against a worker that is about to sleep
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        pending++;
+    }
+    job_ready.notify_one();
+}
+
+DetectorPool::Stats DetectorPool::getStats() const {
+    Stats stats;
+    int64_t lifetime_us = std::max<int64_t>(FrameRing::now() - start_us, 1);
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.submitted = submitted;
+        stats.completed = completed;
+        stats.queue_ms_avg = completed ? queue_us_total / 1000.0 / completed : 0;
+        stats.queue_ms_max = queue_us_max / 1000.0;
+    }
+    for (auto &session : sessions) {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        stats.sessions.push_back({session->jobs, session->stolen, (double) session->busy_us / lifetime_us});
+    }
+    return stats;
+}
+
+int DetectorPool::getSessionCount() const {
+    return (int) sessions.size();
+}
+
+// Own queue first, oldest job first; otherwise steal the newest job of the longest other queue, which
+// leaves that session's own oldest work with it
+bool DetectorPool::takeJob(int index, Job& job, bool& stolen) {
+    Session& own = *sessions[index];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.queue.empty()) {
+            job = std::move(own.queue.front());
+            own.queue.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+
+    int victim = -1;
+    size_t longest = 0;
+    for (int i = 0; i < (int) sessions.size(); i++) {
+        if (i == index) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(sessions[i]->mutex);
+        if (sessions[i]->queue.size() > longest) {
+            longest = sessions[i]->queue.size();
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(sessions[victim]->mutex);
+    if (sessions[victim]->queue.empty()) {
+        return false;  // Drained in the meantime, the caller retries
+    }
+    job = std::move(sessions[victim]->queue.back());
+    sessions[victim]->queue.pop_back();
+    stolen = true;
+    return true;
+}
+
+void DetectorPool::workerLoop(int index) {
+    Session& session = *sessions[index];
+    std::vector<FaceInfo> faces;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            job_ready.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping) {
+                return;
+            }
+        }
+        // Claim one queued job; a claim always has a job to match, though it may sit in another queue
+        int available = pending;
+        while (available > 0 && !pending.compare_exchange_weak(available, available - 1)) {
+        }
+        if (available <= 0) {
+            continue;
+        }
+
+        Job job;
+        bool stolen;
+        while (!takeJob(index, job, stolen)) {
+            std::this_thread::yield();
+        }
+
+        int64_t start = FrameRing::now();
+        faces.clear();
+        int status = detector.detect(*session.context, job.frame, faces, job.format);
+        int64_t end = FrameRing::now();
+        job.done(status, faces);
+
+        {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            session.jobs++;
+            session.stolen += stolen;
+            session.busy_us += end - start;
+        }
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        completed++;
+        queue_us_total += start - job.submitted_us;
+        queue_us_max = std::max(queue_us_max, start - job.submitted_us);
+    }
+}
@@ -0,0 +1,91 @@
+#ifdef USE_ONNXRUNTIME
+
+#include "FaceDecodeNmsOp.hpp"
+
+#include <memory>
+#include <vector>
+#include "AnchorTable.hpp"
+#include "BoxDecoder.hpp"
+#include "NmsEngine.hpp"
+
+template<typename T>
+static T attribute(const OrtKernelInfo* info, const char* name, T fallback) {
+    try {
+        return Ort::ConstKernelInfo(info).GetAttribute<T>(name);
+    } catch (const Ort::Exception&) {
+        return fallback;
+    }
+}
+
+// Defaults are UltraFace's constructor defaults
+FaceDecodeNmsKernel::FaceDecodeNmsKernel(const OrtApi*, const OrtKernelInfo* info)
+    : score_threshold(attribute<float>(info, "score_threshold", 0.7f)),
+      iou_threshold(attribute<float>(info, "iou_threshold", 0.3f)),
+      nms_type((int) attribute<int64_t>(info, "nms_type", blending_nms)),
+      topk((int) attribute<int64_t>(info, "topk", -1)),
+      center_variance(attribute<float>(info, "center_variance", 0.1f)),
+      size_variance(attribute<float>(info, "size_variance", 0.2f)) {
+}
+
+Ort::Status FaceDecodeNmsKernel::Compute(const Ort::Custom::Tensor<float>& scores,
+                                         const Ort::Custom::Tensor<float>& boxes,
+                                         const Ort::Custom::Tensor<float>& anchors,
+                                         const Ort::Custom::Tensor<float>& image_sizes,
+                                         Ort::Custom::Tensor<float>& faces) {
+    const std::vector<int64_t>& shape = scores.Shape();
+    if (shape.size() != 3 || shape[2] != 2) {
+        return Ort::Status("FaceDecodeNms: scores must be [N, A, 2]", ORT_INVALID_ARGUMENT);
+    }
+    int batch = (int) shape[0];
+    int count = (int) shape[1];
+    if (boxes.NumberOfElement() != (int64_t) batch * count * 4 || anchors.NumberOfElement() != (int64_t) count * 4 ||
+        image_sizes.NumberOfElement() != (int64_t) batch * 2) {
+        return Ort::Status("FaceDecodeNms: boxes, anchors or image_sizes don't match scores", ORT_INVALID_ARGUMENT);
+    }
+
+    // ORT may run this kernel from several sessions' Run() at once, so all scratch is per call
+    AnchorTable table(anchors.Data(), count);
+    BoxDecoder decoder(table, center_variance, size_variance);
+    NmsEngine nms_engine(iou_threshold, topk, score_threshold);
+    std::vector<int> candidates;
+    std::vector<FaceInfo> collected;
+    std::vector<FaceInfo> kept;
+    std::vector<int> image_index;
+    const float* sizes = image_sizes.Data();
+    for (int b = 0; b < batch; b++) {
+        candidates.clear();
+        collected.clear();
+        const float* image_scores = scores.Data() + (size_t) b * count * 2;
+        decoder.scan(image_scores, score_threshold, candidates);
+        decoder.decode(image_scores, boxes.Data() + (size_t) b * count * 4, candidates, (int) sizes[b * 2],
+                       (int) sizes[b * 2 + 1], collected);
+        if (nms_engine.run(collected, kept, nms_type) != 0) {
+            return Ort::Status("FaceDecodeNms: unknown nms_type", ORT_INVALID_ARGUMENT);
+        }
+        image_index.resize(kept.size(), b);
+    }
+
+    float* out = faces.Allocate({(int64_t) kept.size(), 6});
+    for (size_t i = 0; i < kept.size(); i++, out += 6) {
+        out[0] = (float) image_index[i];
+        out[1] = kept[i].x1;
+        out[2] = kept[i].y1;
+        out[3] = kept[i].x2;
+        out[4] = kept[i].y2;
+        out[5] = kept[i].score;
+    }
+    return Ort::Status(nullptr);
+}
+
+void addFaceOps(Ort::SessionOptions& options) {
+    static std::unique_ptr<Ort::Custom::OrtLiteCustomOp> op(
+            Ort::Custom::CreateLiteCustomOp<FaceDecodeNmsKernel>("FaceDecodeNms", "CPUExecutionProvider"));
+    static Ort::CustomOpDomain domain = [] {
+        Ort::CustomOpDomain created(FACE_OP_DOMAIN);
+        created.Add(op.get());
+        return created;
+    }();
+    options.Add(domain);
+}
+
+#endif // USE_ONNXRUNTIME
@@ -0,0 +1,112 @@
+#include "FaceTracker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Widest template, in pixels; matching cost grows with the template area times the search area
+#define TRACK_TEMPLATE_PX 32.0f
+
+FaceTracker::FaceTracker(int resync_interval, float min_confidence)
+    : resync_interval(resync_interval), min_confidence(min_confidence), search_margin(0.5f), tracking(false),
+      target({0, 0, 0, 0, 0}), scale(1), frames_since_sync(0), syncs(0), updates(0), lost(0), track_us(0),
+      confidence_total(0) {
+}
+
+void FaceTracker::setResyncInterval(int frames) {
+    resync_interval = frames;
+}
+
+void FaceTracker::setMinConfidence(float score) {
+    min_confidence = score;
+}
+
+void FaceTracker::setSearchMargin(float margin) {
+    search_margin = margin;
+}
+
+void FaceTracker::sync(const cv::Mat& frame, PixelFormat format, const std::vector<FaceInfo>& faces) {
+    syncs++;
+    frames_since_sync = 0;
+    tracking = false;
+    float max_width = 0;
+    for (const FaceInfo& face : faces) {
+        float width = face.x2 - face.x1;
+        if (width > max_width) {
+            max_width = width;
+            target = face;
+        }
+    }
+    cv::Rect rect = cv::Rect((int) target.x1, (int) target.y1, (int) (target.x2 - target.x1),
+                             (int) (target.y2 - target.y1)) & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (max_width <= 0 || rect.width < 4 || rect.height < 4) {
+        return;
+    }
+    scale = std::min(1.0f, TRACK_TEMPLATE_PX / rect.width);
+    grayRegion(frame, format, rect, templ);
+    tracking = true;
+}
+
+bool FaceTracker::update(const cv::Mat& frame, PixelFormat format, FaceInfo& face) {
+    if (!tracking) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    float face_w = target.x2 - target.x1;
+    float face_h = target.y2 - target.y1;
+    cv::Rect rect = cv::Rect((int) (target.x1 - face_w * search_margin), (int) (target.y1 - face_h * search_margin),
+                             (int) (face_w * (1 + 2 * search_margin)), (int) (face_h * (1 + 2 * search_margin))) &
+                    cv::Rect(0, 0, frame.cols, frame.rows);
+    double confidence = -1;
+    cv::Point location;
+    if (!rect.empty()) {
+        grayRegion(frame, format, rect, search);
+        if (search.cols >= templ.cols && search.rows >= templ.rows) {
+            cv::matchTemplate(search, templ, result, cv::TM_CCOEFF_NORMED);
+            cv::minMaxLoc(result, nullptr, &confidence, nullptr, &location);
+        }
+    }
+    frames_since_sync++;
+
+    bool found = confidence >= min_confidence;
+    if (found) {
+        float x1 = rect.x + location.x / scale;
+        float y1 = rect.y + location.y / scale;
+        target = {x1, y1, x1 + face_w, y1 + face_h, (float) confidence};
+        face = target;
+        updates++;
+        confidence_total += (int64_t) (confidence * 1e6);
+    } else {
+        // Stays lost until the next sync(), which needsDetection() now asks for
+        tracking = false;
+        lost++;
+    }
+    track_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return found;
+}
+
+void FaceTracker::grayRegion(const cv::Mat& frame, PixelFormat format, const cv::Rect& rect, cv::Mat& gray) {
+    // Downscale before the color conversion, so only the pixels that are kept get converted
+    cv::Size size(std::max((int) std::lround(rect.width * scale), 1), std::max((int) std::lround(rect.height * scale), 1));
+    cv::resize(frame(rect), color, size, 0, 0, cv::INTER_AREA);
+    cv::cvtColor(color, gray, format == PIXEL_FORMAT_RGB ? cv::COLOR_RGB2GRAY : cv::COLOR_BGR2GRAY);
+}
+
+bool FaceTracker::needsDetection() const {
+    return !tracking || frames_since_sync >= resync_interval;
+}
+
+bool FaceTracker::isTracking() const {
+    return tracking;
+}
+
+FaceTracker::Stats FaceTracker::getStats() const {
+    Stats stats;
+    stats.syncs = syncs;
+    stats.updates = updates;
+    stats.lost = lost;
+    uint64_t calls = stats.updates + stats.lost;
+    stats.track_ms_avg = calls ? track_us / 1000.0 / calls : 0;
+    stats.confidence_avg = stats.updates ? confidence_total / 1e6 / stats.updates : 0;
+    return stats;
+}
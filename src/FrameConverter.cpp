@@ -0,0 +1,24 @@
+#include "FrameConverter.hpp"
+
+FrameConverter::FrameConverter(JpegDecoderBackend backend, int out_width, int out_height)
+    : decoder(JpegDecoder::create(backend, out_width, out_height)) {}
+
+bool FrameConverter::convert(const CapturedFrame& captured, cv::Mat& dst, PixelFormat& format) {
+    if (captured.encoding == FRAME_ENCODING_JPEG) {
+        if (!decoder->decode(captured.data, captured.size, dst)) {
+            return false;
+        }
+        format = decoder->getPixelFormat();
+        return true;
+    }
+
+    cv::Mat yuyv(captured.height, captured.width, CV_8UC2, (void*)captured.data, captured.stride);
+    if (captured.width == dst.cols && captured.height == dst.rows) {
+        cv::cvtColor(yuyv, dst, cv::COLOR_YUV2RGB_YUYV);
+    } else {
+        cv::cvtColor(yuyv, scratch, cv::COLOR_YUV2RGB_YUYV);
+        cv::resize(scratch, dst, dst.size(), 0, 0, cv::INTER_AREA);
+    }
+    format = PIXEL_FORMAT_RGB;
+    return true;
+}
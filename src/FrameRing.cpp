@@ -0,0 +1,120 @@
+#include "FrameRing.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+// The low bits of latest hold a slot index, this bit says the reader has not taken it yet
+#define FRAME_RING_FRESH 0x100u
+#define FRAME_RING_INDEX_MASK 0xffu
+
+struct FrameRing::Control {
+    uint32_t slot_count;
+    uint32_t max_bytes;
+    std::atomic<uint32_t> latest;
+    std::atomic<uint64_t> published;
+};
+
+static size_t alignUp(size_t size) {
+    return (size + 63) & ~(size_t) 63;
+}
+
+FrameRing::FrameRing()
+    : shm_fd(-1), base(nullptr), mapped_size(0), slot_stride(0), control(nullptr), back_index(0), front_index(0),
+      front{nullptr, nullptr} {}
+
+FrameRing::~FrameRing() {
+    destroy();
+}
+
+bool FrameRing::create(const std::string& name, int max_width, int max_height) {
+    size_t max_bytes = (size_t) max_width * max_height * 3;
+    slot_stride = alignUp(sizeof(FrameSlotHeader)) + alignUp(max_bytes);
+    mapped_size = alignUp(sizeof(Control)) + slot_stride * FRAME_RING_SLOTS;
+
+    shm_name = name;
+    shm_fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0666);
+    if (shm_fd < 0 || ftruncate(shm_fd, mapped_size) != 0) {
+        std::cerr << "Failed to create shared memory " << name << "." << std::endl;
+        return false;
+    }
+    base = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        std::cerr << "Failed to map shared memory " << name << "." << std::endl;
+        return false;
+    }
+    memset(base, 0, mapped_size);
+
+    control = new (base) Control();
+    control->slot_count = FRAME_RING_SLOTS;
+    control->max_bytes = max_bytes;
+    control->latest = 1;
+    control->published = 0;
+    back_index = 0;
+    front_index = 2;
+    return true;
+}
+
+void FrameRing::destroy() {
+    if (base) {
+        munmap(base, mapped_size);
+        base = nullptr;
+        control = nullptr;
+    }
+    if (shm_fd >= 0) {
+        close(shm_fd);
+        shm_unlink(shm_name.c_str());
+        shm_fd = -1;
+    }
+}
+
+unsigned char* FrameRing::beginWrite() {
+    return slotData(back_index);
+}
+
+void FrameRing::commitWrite(int width, int height, PixelFormat format, int64_t timestamp_us) {
+    FrameSlotHeader* header = slotHeader(back_index);
+    header->sequence = control->published.load(std::memory_order_relaxed) + 1;
+    header->timestamp_us = timestamp_us;
+    header->width = width;
+    header->height = height;
+    header->format = format;
+    control->published.store(header->sequence, std::memory_order_relaxed);
+
+    // Release makes the pixels and header visible to whoever picks this slot up
+    uint32_t previous = control->latest.exchange(back_index | FRAME_RING_FRESH, std::memory_order_acq_rel);
+    back_index = previous & FRAME_RING_INDEX_MASK;
+}
+
+const FrameSlot* FrameRing::acquireLatest() {
+    if (!(control->latest.load(std::memory_order_relaxed) & FRAME_RING_FRESH)) {
+        return nullptr;
+    }
+    uint32_t latest = control->latest.exchange(front_index, std::memory_order_acq_rel);
+    front_index = latest & FRAME_RING_INDEX_MASK;
+    front.header = slotHeader(front_index);
+    front.data = slotData(front_index);
+    return &front;
+}
+
+uint64_t FrameRing::getPublishedCount() const {
+    return control ? control->published.load(std::memory_order_relaxed) : 0;
+}
+
+int64_t FrameRing::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FrameSlotHeader* FrameRing::slotHeader(int index) const {
+    return reinterpret_cast<FrameSlotHeader*>((char*) base + alignUp(sizeof(Control)) + slot_stride * index);
+}
+
+unsigned char* FrameRing::slotData(int index) const {
+    return reinterpret_cast<unsigned char*>(slotHeader(index)) + alignUp(sizeof(FrameSlotHeader));
+}
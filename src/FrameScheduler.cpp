@@ -0,0 +1,89 @@
+#include "FrameScheduler.hpp"
+
+#include <algorithm>
+
+const int FrameScheduler::age_bucket_limits_ms[FRAME_AGE_BUCKETS - 1] = {10, 20, 50, 100, 200, 500};
+
+// Weight of the newest latency sample in the moving average
+static const double latency_alpha = 0.2;
+// Capture a little faster than inference so a fresh frame is already waiting when the detector frees up
+static const double capture_headroom = 0.9;
+
+FrameScheduler::FrameScheduler(int deadline_ms, int min_interval_ms, int max_interval_ms)
+    : deadline_us(deadline_ms * 1000LL), min_interval_us(min_interval_ms * 1000LL),
+      max_interval_us(max_interval_ms * 1000LL), latency_average_us(0), last_capture_us(0), frames_admitted(0),
+      frames_dropped(0), frames_throttled(0) {
+    for (auto &bucket : age_histogram) {
+        bucket = 0;
+    }
+}
+
+bool FrameScheduler::shouldCapture(int64_t now_us) {
+    if (last_capture_us != 0 && now_us - last_capture_us < getCaptureIntervalUs()) {
+        frames_throttled++;
+        return false;
+    }
+    last_capture_us = now_us;
+    return true;
+}
+
+int64_t FrameScheduler::getCaptureIntervalUs() const {
+    int64_t latency = latency_average_us.load(std::memory_order_relaxed);
+    if (latency == 0) {
+        return min_interval_us;
+    }
+    return std::min(max_interval_us, std::max(min_interval_us, (int64_t) (latency * capture_headroom)));
+}
+
+bool FrameScheduler::admit(int64_t capture_timestamp_us, int64_t now_us) {
+    int64_t age_ms = (now_us - capture_timestamp_us) / 1000;
+    int bucket = 0;
+    while (bucket < FRAME_AGE_BUCKETS - 1 && age_ms >= age_bucket_limits_ms[bucket]) {
+        bucket++;
+    }
+    age_histogram[bucket]++;
+
+    // Never tighter than one capture interval, otherwise a detector slower than the deadline would starve
+    int64_t deadline = std::max(deadline_us.load(std::memory_order_relaxed), getCaptureIntervalUs() + min_interval_us);
+    if (now_us - capture_timestamp_us > deadline) {
+        frames_dropped++;
+        return false;
+    }
+    frames_admitted++;
+    return true;
+}
+
+void FrameScheduler::recordDetectLatency(int64_t latency_us) {
+    int64_t average = latency_average_us.load(std::memory_order_relaxed);
+    if (average == 0) {
+        average = latency_us;
+    } else {
+        average = (int64_t) (latency_alpha * latency_us + (1.0 - latency_alpha) * average);
+    }
+    latency_average_us.store(std::max<int64_t>(average, 1), std::memory_order_relaxed);
+}
+
+void FrameScheduler::reset() {
+    latency_average_us = 0;
+}
+
+void FrameScheduler::setDeadlineMs(int deadline_ms) {
+    deadline_us = deadline_ms * 1000LL;
+}
+
+int FrameScheduler::getDeadlineMs() const {
+    return (int) (deadline_us / 1000);
+}
+
+FrameScheduler::Stats FrameScheduler::getStats() const {
+    Stats stats;
+    stats.detect_latency_ms = latency_average_us / 1000.0;
+    stats.capture_interval_ms = getCaptureIntervalUs() / 1000.0;
+    stats.frames_admitted = frames_admitted;
+    stats.frames_dropped = frames_dropped;
+    stats.frames_throttled = frames_throttled;
+    for (int i = 0; i < FRAME_AGE_BUCKETS; i++) {
+        stats.age_histogram[i] = age_histogram[i];
+    }
+    return stats;
+}
@@ -0,0 +1,288 @@
+#include "FusedPreprocessor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PREPROCESS_NEON 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PREPROCESS_X86 1
+#endif
+
+// Converts one row of width 3-channel pixels. s0/s1/s2 pick the source byte feeding output
+// channel 0/1/2, which is how the BGR -> RGB swap is folded in for free.
+typedef void (*RowKernel)(const uint8_t* src, int width, int s0, int s1, int s2, const float* scale,
+                          const float* bias, float* dst, int plane, bool c4);
+
+static void rowScalar(const uint8_t* src, int width, int s0, int s1, int s2, const float* scale,
+                      const float* bias, float* dst, int plane, bool c4, int start) {
+    for (int x = start; x < width; x++) {
+        const uint8_t* p = src + x * 3;
+        float c0 = p[s0] * scale[0] + bias[0];
+        float c1 = p[s1] * scale[1] + bias[1];
+        float c2 = p[s2] * scale[2] + bias[2];
+        if (c4) {
+            dst[x * 4] = c0;
+            dst[x * 4 + 1] = c1;
+            dst[x * 4 + 2] = c2;
+            dst[x * 4 + 3] = 0;
+        } else {
+            dst[x] = c0;
+            dst[plane + x] = c1;
+            dst[plane * 2 + x] = c2;
+        }
+    }
+}
+
+static void rowKernelScalar(const uint8_t* src, int width, int s0, int s1, int s2, const float* scale,
+                            const float* bias, float* dst, int plane, bool c4) {
+    rowScalar(src, width, s0, s1, s2, scale, bias, dst, plane, c4, 0);
+}
+
+#ifdef PREPROCESS_NEON
+static void rowKernelNeon(const uint8_t* src, int width, int s0, int s1, int s2, const float* scale,
+                          const float* bias, float* dst, int plane, bool c4) {
+    const float32x4_t k0 = vdupq_n_f32(scale[0]), k1 = vdupq_n_f32(scale[1]), k2 = vdupq_n_f32(scale[2]);
+    const float32x4_t b0 = vdupq_n_f32(bias[0]), b1 = vdupq_n_f32(bias[1]), b2 = vdupq_n_f32(bias[2]);
+    const float32x4_t zero = vdupq_n_f32(0);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x3_t px = vld3_u8(src + x * 3);
+        uint16x8_t w0 = vmovl_u8(px.val[s0]);
+        uint16x8_t w1 = vmovl_u8(px.val[s1]);
+        uint16x8_t w2 = vmovl_u8(px.val[s2]);
+        for (int half = 0; half < 2; half++) {
+            uint16x4_t h0 = half ? vget_high_u16(w0) : vget_low_u16(w0);
+            uint16x4_t h1 = half ? vget_high_u16(w1) : vget_low_u16(w1);
+            uint16x4_t h2 = half ? vget_high_u16(w2) : vget_low_u16(w2);
+            float32x4_t c0 = vmlaq_f32(b0, vcvtq_f32_u32(vmovl_u16(h0)), k0);
+            float32x4_t c1 = vmlaq_f32(b1, vcvtq_f32_u32(vmovl_u16(h1)), k1);
+            float32x4_t c2 = vmlaq_f32(b2, vcvtq_f32_u32(vmovl_u16(h2)), k2);
+            int i = x + half * 4;
+            if (c4) {
+                float32x4x4_t out = {{c0, c1, c2, zero}};
+                vst4q_f32(dst + i * 4, out);
+            } else {
+                vst1q_f32(dst + i, c0);
+                vst1q_f32(dst + plane + i, c1);
+                vst1q_f32(dst + plane * 2 + i, c2);
+            }
+        }
+    }
+    rowScalar(src, width, s0, s1, s2, scale, bias, dst, plane, c4, x);
+}
+#endif
+
+#ifdef PREPROCESS_X86
+// Byte shuffles moving channel c of four packed RGB pixels into the low byte of four 32-bit lanes
+static inline __m128i channelMask(int c) {
+    return _mm_setr_epi8(c, -1, -1, -1, c + 3, -1, -1, -1, c + 6, -1, -1, -1, c + 9, -1, -1, -1);
+}
+
+static inline void storeC4(float* dst, __m128 c0, __m128 c1, __m128 c2) {
+    __m128 c3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(dst, c0);
+    _mm_storeu_ps(dst + 4, c1);
+    _mm_storeu_ps(dst + 8, c2);
+    _mm_storeu_ps(dst + 12, c3);
+}
+
+__attribute__((target("ssse3")))
+static void rowKernelSsse3(const uint8_t* src, int width, int s0, int s1, int s2, const float* scale,
+                           const float* bias, float* dst, int plane, bool c4) {
+    const __m128i m0 = channelMask(s0), m1 = channelMask(s1), m2 = channelMask(s2);
+    const __m128 k0 = _mm_set1_ps(scale[0]), k1 = _mm_set1_ps(scale[1]), k2 = _mm_set1_ps(scale[2]);
+    const __m128 b0 = _mm_set1_ps(bias[0]), b1 = _mm_set1_ps(bias[1]), b2 = _mm_set1_ps(bias[2]);
+    int x = 0;
+    // A 16-byte load covers 4 pixels plus 4 spare bytes, so stop while those are still inside the row
+    for (; x + 6 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*) (src + x * 3));
+        __m128 c0 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_shuffle_epi8(px, m0)), k0), b0);
+        __m128 c1 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_shuffle_epi8(px, m1)), k1), b1);
+        __m128 c2 = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_shuffle_epi8(px, m2)), k2), b2);
+        if (c4) {
+            storeC4(dst + x * 4, c0, c1, c2);
+        } else {
+            _mm_storeu_ps(dst + x, c0);
+            _mm_storeu_ps(dst + plane + x, c1);
+            _mm_storeu_ps(dst + plane * 2 + x, c2);
+        }
+    }
+    rowScalar(src, width, s0, s1, s2, scale, bias, dst, plane, c4, x);
+}
+
+__attribute__((target("avx2")))
+static void rowKernelAvx2(const uint8_t* src, int width, int s0, int s1, int s2, const float* scale,
+                          const float* bias, float* dst, int plane, bool c4) {
+    const __m256i m0 = _mm256_broadcastsi128_si256(channelMask(s0));
+    const __m256i m1 = _mm256_broadcastsi128_si256(channelMask(s1));
+    const __m256i m2 = _mm256_broadcastsi128_si256(channelMask(s2));
+    const __m256 k0 = _mm256_set1_ps(scale[0]), k1 = _mm256_set1_ps(scale[1]), k2 = _mm256_set1_ps(scale[2]);
+    const __m256 b0 = _mm256_set1_ps(bias[0]), b1 = _mm256_set1_ps(bias[1]), b2 = _mm256_set1_ps(bias[2]);
+    int x = 0;
+    // Pixels x..x+3 go in the low lane and x+4..x+7 in the high lane; the second load reads 4 spare bytes
+    for (; x + 10 <= width; x += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i*) (src + x * 3));
+        __m128i hi = _mm_loadu_si128((const __m128i*) (src + x * 3 + 12));
+        __m256i px = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        __m256 c0 = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_shuffle_epi8(px, m0)), k0), b0);
+        __m256 c1 = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_shuffle_epi8(px, m1)), k1), b1);
+        __m256 c2 = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_shuffle_epi8(px, m2)), k2), b2);
+        if (c4) {
+            storeC4(dst + x * 4, _mm256_castps256_ps128(c0), _mm256_castps256_ps128(c1), _mm256_castps256_ps128(c2));
+            storeC4(dst + x * 4 + 16, _mm256_extractf128_ps(c0, 1), _mm256_extractf128_ps(c1, 1),
+                    _mm256_extractf128_ps(c2, 1));
+        } else {
+            _mm256_storeu_ps(dst + x, c0);
+            _mm256_storeu_ps(dst + plane + x, c1);
+            _mm256_storeu_ps(dst + plane * 2 + x, c2);
+        }
+    }
+    rowScalar(src, width, s0, s1, s2, scale, bias, dst, plane, c4, x);
+}
+#endif
+
+static RowKernel selectKernel(const char** name) {
+#if defined(PREPROCESS_NEON)
+    *name = "neon";
+    return rowKernelNeon;
+#elif defined(PREPROCESS_X86)
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return rowKernelAvx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        *name = "ssse3";
+        return rowKernelSsse3;
+    }
+#endif
+    *name = "scalar";
+    return rowKernelScalar;
+}
+
+static const char* kernel_name = nullptr;
+static const RowKernel row_kernel = selectKernel(&kernel_name);
+
+FusedPreprocessor::FusedPreprocessor(const float mean[3], const float norm[3])
+    : bilinear(true), offsets_src_w(0), offsets_bilinear(false) {
+    for (int c = 0; c < 3; c++) {
+        scale[c] = norm[c];
+        bias[c] = -mean[c] * norm[c];
+    }
+}
+
+void FusedPreprocessor::setBilinear(bool enable) {
+    bilinear = enable;
+}
+
+const char* FusedPreprocessor::kernelName() {
+    return kernel_name;
+}
+
+void FusedPreprocessor::convert(const uint8_t* src, int src_w, int src_h, int src_stride, PixelFormat format,
+                                MNN::Tensor* input, int batch_index) {
+    int dst_w = input->width();
+    int dst_h = input->height();
+    int batch = input->batch();
+    bool swap_rb = format == PIXEL_FORMAT_BGR;
+
+    float* host = input->host<float>();
+    if (host) {
+        // MNN's CPU backend keeps CAFFE inputs as NC4HW4, which shows in the padded element count
+        bool c4 = input->elementSize() == batch * 4 * dst_w * dst_h;
+        size_t slot = (size_t) batch_index * (c4 ? 4 : 3) * dst_w * dst_h;
+        run(src, src_w, src_h, src_stride, swap_rb, host + slot, dst_w, dst_h, c4);
+        return;
+    }
+
+    if (!staging || staging->width() != dst_w || staging->height() != dst_h || staging->batch() != batch) {
+        staging.reset(new MNN::Tensor(input, MNN::Tensor::CAFFE));
+    }
+    size_t slot = (size_t) batch_index * 3 * dst_w * dst_h;
+    run(src, src_w, src_h, src_stride, swap_rb, staging->host<float>() + slot, dst_w, dst_h, false);
+    if (batch_index == batch - 1) {
+        input->copyFromHostTensor(staging.get());
+    }
+}
+
+// Source sample position for output index i along an axis, on the pixel-center grid cv::resize uses.
+// Returns the left/top neighbour and the weight of the right/bottom one in 1/256ths.
+static int sourcePosition(int i, int src, int dst, int* weight) {
+    float f = (i + 0.5f) * src / dst - 0.5f;
+    int p = (int) std::floor(f);
+    *weight = (int) std::lround((f - p) * 256);
+    if (p < 0) {
+        p = 0;
+        *weight = 0;
+    } else if (p >= src - 1) {
+        p = src - 1;
+        *weight = 0;
+    }
+    return p;
+}
+
+void FusedPreprocessor::run(const uint8_t* src, int src_w, int src_h, int src_stride, bool swap_rb, float* dst,
+                            int dst_w, int dst_h, bool c4) {
+    int s0 = swap_rb ? 2 : 0;
+    int s2 = swap_rb ? 0 : 2;
+    int plane = dst_w * dst_h;
+    bool resize = src_w != dst_w || src_h != dst_h;
+
+    if (resize && (offsets_src_w != src_w || (int) x_offsets.size() != dst_w || offsets_bilinear != bilinear)) {
+        x_offsets.resize(dst_w);
+        x_next.resize(dst_w);
+        x_weights.resize(dst_w);
+        for (int x = 0; x < dst_w; x++) {
+            if (bilinear) {
+                int sx = sourcePosition(x, src_w, dst_w, &x_weights[x]);
+                x_offsets[x] = sx * 3;
+                x_next[x] = std::min(sx + 1, src_w - 1) * 3;
+            } else {
+                x_offsets[x] = x_next[x] = (int) ((x + 0.5f) * src_w / dst_w) * 3;
+                x_weights[x] = 0;
+            }
+        }
+        offsets_src_w = src_w;
+        offsets_bilinear = bilinear;
+        row.resize(dst_w * 3 + 16);  // Slack for the vector loads past the last pixel
+    }
+
+    for (int y = 0; y < dst_h; y++) {
+        float* out = c4 ? dst + (size_t) y * dst_w * 4 : dst + (size_t) y * dst_w;
+        if (!resize) {
+            row_kernel(src + (size_t) y * src_stride, dst_w, s0, 1, s2, scale, bias, out, plane, c4);
+            continue;
+        }
+        int wy = 0;
+        int sy = bilinear ? sourcePosition(y, src_h, dst_h, &wy) : (int) ((y + 0.5f) * src_h / dst_h);
+        const uint8_t* r0 = src + (size_t) sy * src_stride;
+        const uint8_t* r1 = src + (size_t) std::min(sy + 1, src_h - 1) * src_stride;
+        uint8_t* p = row.data();
+        if (!bilinear) {
+            for (int x = 0; x < dst_w; x++, p += 3) {
+                const uint8_t* s = r0 + x_offsets[x];
+                p[0] = s[0];
+                p[1] = s[1];
+                p[2] = s[2];
+            }
+        } else {
+            // Fixed point as in cv::resize; at an exact 2x downscale every weight is one half, a 2x2 box filter
+            for (int x = 0; x < dst_w; x++, p += 3) {
+                int wx = x_weights[x];
+                const uint8_t* a0 = r0 + x_offsets[x];
+                const uint8_t* b0 = r0 + x_next[x];
+                const uint8_t* a1 = r1 + x_offsets[x];
+                const uint8_t* b1 = r1 + x_next[x];
+                for (int c = 0; c < 3; c++) {
+                    int top = a0[c] * (256 - wx) + b0[c] * wx;
+                    int bottom = a1[c] * (256 - wx) + b1[c] * wx;
+                    p[c] = (uint8_t) ((top * (256 - wy) + bottom * wy + 32768) >> 16);
+                }
+            }
+        }
+        row_kernel(row.data(), dst_w, s0, 1, s2, scale, bias, out, plane, c4);
+    }
+}
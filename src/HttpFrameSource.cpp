@@ -0,0 +1,178 @@
+#include "HttpFrameSource.hpp"
+
+#include <curl/curl.h>
+#include <strings.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "MjpegStreamParser.hpp"
+
+// Receive buffer for ?action=snapshot, sized from Content-Length and kept across requests
+struct SnapshotBuffer {
+    std::vector<unsigned char> data;
+    size_t size = 0;
+};
+
+struct StreamContext {
+    MjpegStreamParser* parser;
+    const std::atomic<bool>* running;
+    const std::atomic<int>* mode;
+};
+
+static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    SnapshotBuffer* buffer = (SnapshotBuffer*)userp;
+    size_t n = size * nmemb;
+    if (buffer->size + n > buffer->data.size()) {
+        buffer->data.resize(buffer->size + n);
+    }
+    memcpy(buffer->data.data() + buffer->size, contents, n);
+    buffer->size += n;
+    return n;
+}
+
+static size_t SnapshotHeaderCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    size_t n = size * nitems;
+    if (n > 15 && strncasecmp(buffer, "Content-Length:", 15) == 0) {
+        SnapshotBuffer* snapshot = (SnapshotBuffer*)userp;
+        size_t length = strtoul(buffer + 15, nullptr, 10);
+        if (length > snapshot->data.size()) {
+            snapshot->data.resize(length);
+        }
+    }
+    return n;
+}
+
+static size_t StreamWriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    StreamContext* context = (StreamContext*)userp;
+    // Returning a short count makes libcurl abort the transfer, which is how the stream is closed
+    if (!*context->running || *context->mode != HTTP_CAPTURE_STREAM) {
+        return 0;
+    }
+    context->parser->feed((char*)contents, size * nmemb);
+    return size * nmemb;
+}
+
+static size_t StreamHeaderCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    std::string header(buffer, size * nitems);
+    size_t pos = header.find("boundary=");
+    if (pos != std::string::npos) {
+        std::string boundary = header.substr(pos + 9);
+        boundary.erase(boundary.find_last_not_of(" \r\n") + 1);
+        ((StreamContext*)userp)->parser->setBoundary(boundary);
+    }
+    return size * nitems;
+}
+
+// Sleeps in short steps so a stop request isn't held up by a long backoff
+static void sleepWhileRunning(const std::atomic<bool>& running, int ms) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (running && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                std::chrono::milliseconds(100), until - std::chrono::steady_clock::now()));
+    }
+}
+
+HttpFrameSource::HttpFrameSource(const std::string& snapshot_url, const std::string& stream_url, int mode)
+    : snapshot_url(snapshot_url), stream_url(stream_url), capture_mode(mode), stream_fallback(false) {}
+
+bool HttpFrameSource::run(const std::atomic<bool>& running, const FrameCallback& callback) {
+    int retry_ms = HTTP_STREAM_RETRY_MIN_MS;
+    while (running) {
+        if (capture_mode == HTTP_CAPTURE_STREAM) {
+            bool delivered = runStream(running, callback);
+            if (!running || capture_mode != HTTP_CAPTURE_STREAM) {
+                continue;
+            }
+            if (delivered) {
+                // Dropped after working: reconnect, but not in a tight loop if it keeps dropping
+                retry_ms = HTTP_STREAM_RETRY_MIN_MS;
+                sleepWhileRunning(running, retry_ms);
+            } else {
+                std::cerr << "MJPEG stream unavailable, polling snapshots and retrying it in " << retry_ms
+                          << " ms." << std::endl;
+                stream_fallback = true;
+                capture_mode = HTTP_CAPTURE_SNAPSHOT;
+            }
+        } else if (stream_fallback) {
+            runSnapshots(running, callback, std::chrono::steady_clock::now() + std::chrono::milliseconds(retry_ms));
+            retry_ms = std::min(retry_ms * 2, HTTP_STREAM_RETRY_MAX_MS);
+            // setMode() may have picked snapshots meanwhile; then they stay
+            int expected = HTTP_CAPTURE_SNAPSHOT;
+            if (stream_fallback.exchange(false)) {
+                capture_mode.compare_exchange_strong(expected, HTTP_CAPTURE_STREAM);
+            }
+        } else {
+            runSnapshots(running, callback, std::chrono::steady_clock::time_point::max());
+        }
+    }
+    return true;
+}
+
+void HttpFrameSource::setMode(int mode) {
+    stream_fallback = false;
+    capture_mode = mode;
+}
+
+int HttpFrameSource::getMode() const {
+    return capture_mode;
+}
+
+void HttpFrameSource::runSnapshots(const std::atomic<bool>& running, const FrameCallback& callback,
+                                   std::chrono::steady_clock::time_point retry_at) {
+    CURL* curl = curl_easy_init();
+    curl_easy_setopt(curl, CURLOPT_URL, snapshot_url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    SnapshotBuffer readBuffer;
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, SnapshotHeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &readBuffer);
+
+    while (running && capture_mode == HTTP_CAPTURE_SNAPSHOT && std::chrono::steady_clock::now() < retry_at) {
+        auto start = std::chrono::steady_clock::now();
+        readBuffer.size = 0;
+        CURLcode res = curl_easy_perform(curl);
+        if (res == CURLE_OK) {
+            CapturedFrame frame = {readBuffer.data.data(), readBuffer.size, FRAME_ENCODING_JPEG, 0, 0, 0, readBuffer.size};
+            callback(frame);
+        } else {
+            std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
+        }
+        auto interval = std::chrono::microseconds(scheduler ? scheduler->getCaptureIntervalUs() : 200000);
+        std::this_thread::sleep_until(start + interval);
+    }
+
+    curl_easy_cleanup(curl);
+}
+
+// Holds one connection open and delivers every JPEG part as it arrives.
+// Returns false if the stream delivered no frame at all, so run() can fall back to snapshots.
+bool HttpFrameSource::runStream(const std::atomic<bool>& running, const FrameCallback& callback) {
+    MjpegStreamParser parser([&](const unsigned char* jpeg, size_t size) {
+        CapturedFrame frame = {jpeg, size, FRAME_ENCODING_JPEG, 0, 0, 0, parser.getFrameBytesCopied()};
+        callback(frame);
+    });
+    StreamContext context = {&parser, &running, &capture_mode};
+
+    CURL* curl = curl_easy_init();
+    curl_easy_setopt(curl, CURLOPT_URL, stream_url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, StreamWriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &context);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, StreamHeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &context);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, 2000L);
+    // A stalled camera would otherwise block curl_easy_perform() forever
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 3L);
+
+    CURLcode res = curl_easy_perform(curl);
+    if (res != CURLE_OK && running && capture_mode == HTTP_CAPTURE_STREAM) {
+        std::cerr << "MJPEG stream closed: " << curl_easy_strerror(res) << std::endl;
+    }
+    curl_easy_cleanup(curl);
+
+    return parser.getFrameCount() > 0;
+}
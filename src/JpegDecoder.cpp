@@ -0,0 +1,105 @@
+#include "JpegDecoder.hpp"
+
+#include <iostream>
+
+std::unique_ptr<JpegDecoder> JpegDecoder::create(JpegDecoderBackend backend, int out_width, int out_height) {
+    switch (backend) {
+        case JPEG_DECODER_OPENCV:
+            return std::unique_ptr<JpegDecoder>(new OpenCvJpegDecoder(out_width, out_height));
+        case JPEG_DECODER_SCALED:
+            return std::unique_ptr<JpegDecoder>(new ScaledJpegDecoder(out_width, out_height));
+    }
+    return nullptr;
+}
+
+OpenCvJpegDecoder::OpenCvJpegDecoder(int out_width, int out_height) : JpegDecoder(out_width, out_height) {}
+
+bool OpenCvJpegDecoder::decode(const unsigned char* data, size_t size, cv::Mat& dst) {
+    // Wraps the receive buffer, imdecode reads it without copying
+    cv::Mat encoded(1, static_cast<int>(size), CV_8UC1, const_cast<unsigned char*>(data));
+
+    if (source_size == cv::Size(out_w, out_h)) {
+        // Same size as the output: decode straight into it
+        uchar* target = dst.data;
+        cv::imdecode(encoded, cv::IMREAD_COLOR, &dst);
+        if (dst.data == target) {
+            return !dst.empty();
+        }
+        // The camera changed resolution and imdecode had to reallocate; keep that image as scratch
+        decoded = dst;
+        dst = cv::Mat(out_h, out_w, CV_8UC3, target);
+    } else {
+        cv::imdecode(encoded, cv::IMREAD_COLOR, &decoded);
+    }
+
+    if (decoded.empty()) {
+        return false;
+    }
+    source_size = decoded.size();
+    cv::resize(decoded, dst, dst.size(), 0, 0, cv::INTER_NEAREST);
+    return true;
+}
+
+ScaledJpegDecoder::ScaledJpegDecoder(int out_width, int out_height) : JpegDecoder(out_width, out_height) {
+    cinfo.err = jpeg_std_error(&error.pub);
+    error.pub.error_exit = onError;
+    jpeg_create_decompress(&cinfo);
+}
+
+ScaledJpegDecoder::~ScaledJpegDecoder() {
+    jpeg_destroy_decompress(&cinfo);
+}
+
+void ScaledJpegDecoder::onError(j_common_ptr cinfo) {
+    ErrorManager* error = reinterpret_cast<ErrorManager*>(cinfo->err);
+    char message[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, message);
+    std::cerr << "JPEG decode error: " << message << std::endl;
+    longjmp(error->setjmp_buffer, 1);
+}
+
+bool ScaledJpegDecoder::decode(const unsigned char* data, size_t size, cv::Mat& dst) {
+    if (setjmp(error.setjmp_buffer)) {
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), size);
+    jpeg_read_header(&cinfo, TRUE);
+
+    // Largest reduction that still leaves at least out_w x out_h pixels
+    int denom = 8;
+    while (denom > 1 && ((int) (cinfo.image_width + denom - 1) / denom < out_w ||
+                         (int) (cinfo.image_height + denom - 1) / denom < out_h)) {
+        denom /= 2;
+    }
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.dct_method = JDCT_IFAST;
+
+    jpeg_start_decompress(&cinfo);
+    bool exact = (int) cinfo.output_width == out_w && (int) cinfo.output_height == out_h;
+    if (!exact) {
+        scaled.create(cinfo.output_height, cinfo.output_width, CV_8UC3);
+    }
+    readScanlines(exact ? dst : scaled);
+    jpeg_finish_decompress(&cinfo);
+
+    if (!exact) {
+        // Never more than a 2x reduction left here, which INTER_AREA handles without aliasing
+        cv::resize(scaled, dst, dst.size(), 0, 0, cv::INTER_AREA);
+    }
+    return true;
+}
+
+void ScaledJpegDecoder::readScanlines(cv::Mat& target) {
+    JSAMPROW rows[4];
+    while (cinfo.output_scanline < cinfo.output_height) {
+        int count = 0;
+        for (; count < 4 && cinfo.output_scanline + count < cinfo.output_height; count++) {
+            rows[count] = target.ptr(cinfo.output_scanline + count);
+        }
+        jpeg_read_scanlines(&cinfo, rows, count);
+    }
+}
@@ -0,0 +1,167 @@
+#include "MjpegStreamParser.hpp"
+
+#include <strings.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// Headers of a single part never get anywhere near this; anything larger means we lost sync
+static const size_t max_header_size = 8192;
+
+MjpegStreamParser::MjpegStreamParser(FrameCallback callback, const std::string& boundary)
+    : on_frame(std::move(callback)), body_size(0), state(SEEK_BOUNDARY), content_length(-1), scan_pos(0),
+      frame_count(0), bytes_copied(0), frame_bytes_copied(0) {
+    setBoundary(boundary);
+}
+
+void MjpegStreamParser::setBoundary(const std::string& boundary) {
+    std::string value = boundary;
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        value = value.substr(1, value.size() - 2);
+    }
+    if (value.compare(0, 2, "--") == 0) {
+        value = value.substr(2);
+    }
+    delimiter = "--" + value;
+    part_end = "\r\n" + delimiter;
+    reset();
+}
+
+void MjpegStreamParser::feed(const char* data, size_t size) {
+    while (size > 0) {
+        size_t used = state == READ_BODY ? readBody(data, size) : readPreamble(data, size);
+        data += used;
+        size -= used;
+    }
+}
+
+void MjpegStreamParser::reset() {
+    buffer.clear();
+    body_size = 0;
+    state = SEEK_BOUNDARY;
+    content_length = -1;
+    scan_pos = 0;
+    bytes_copied = 0;
+}
+
+size_t MjpegStreamParser::getFrameCount() const {
+    return frame_count;
+}
+
+size_t MjpegStreamParser::getFrameBytesCopied() const {
+    return frame_bytes_copied;
+}
+
+// Consumes the boundary line and part headers. Returns how many bytes of data belong to them,
+// so the body that follows in the same chunk can be read straight from libcurl's buffer.
+size_t MjpegStreamParser::readPreamble(const char* data, size_t size) {
+    size_t prior = buffer.size();
+    buffer.append(data, size);
+
+    size_t pos = 0;
+    if (state == SEEK_BOUNDARY) {
+        pos = buffer.find(delimiter);
+        if (pos == std::string::npos) {
+            // Keep a tail in case the delimiter is split across two chunks
+            if (buffer.size() >= delimiter.size()) {
+                buffer.erase(0, buffer.size() - delimiter.size() + 1);
+            }
+            return size;
+        }
+        pos += delimiter.size();
+        state = READ_HEADERS;
+        content_length = -1;
+    }
+
+    size_t end = buffer.find("\r\n\r\n", pos);
+    if (end == std::string::npos) {
+        buffer.erase(0, pos);
+        if (buffer.size() > max_header_size) {
+            reset();
+        }
+        return size;
+    }
+
+    size_t line_start = pos;
+    while (line_start < end) {
+        size_t line_end = buffer.find("\r\n", line_start);
+        if (line_end == std::string::npos || line_end > end) {
+            line_end = end;
+        }
+        if (line_end - line_start > 15 && strncasecmp(buffer.c_str() + line_start, "content-length:", 15) == 0) {
+            content_length = std::strtol(buffer.c_str() + line_start + 15, nullptr, 10);
+        }
+        line_start = line_end + 2;
+    }
+
+    size_t body_start = end + 4;
+    buffer.clear();
+    state = READ_BODY;
+    body_size = 0;
+    scan_pos = 0;
+    if (content_length >= 0) {
+        reserveBody(content_length);
+    }
+    return body_start - prior;
+}
+
+size_t MjpegStreamParser::readBody(const char* data, size_t size) {
+    if (content_length >= 0) {
+        size_t n = std::min(size, static_cast<size_t>(content_length) - body_size);
+        memcpy(body.data() + body_size, data, n);
+        body_size += n;
+        bytes_copied += n;
+        if (body_size == static_cast<size_t>(content_length)) {
+            emitBody(body_size);
+        }
+        return n;
+    }
+
+    // No Content-Length: the part ends at the CRLF preceding the next delimiter
+    reserveBody(body_size + size);
+    memcpy(body.data() + body_size, data, size);
+    body_size += size;
+    bytes_copied += size;
+
+    auto first = body.begin() + scan_pos;
+    auto last = body.begin() + body_size;
+    auto found = std::search(first, last, part_end.begin(), part_end.end());
+    if (found == last) {
+        scan_pos = body_size > part_end.size() ? body_size - part_end.size() + 1 : 0;
+        return size;
+    }
+
+    size_t pos = found - body.begin();
+    size_t chunk_start = body_size - size;
+    size_t frame_size = pos;
+    while (frame_size >= 2 && body[frame_size - 2] == '\r' && body[frame_size - 1] == '\n') {
+        frame_size -= 2;
+    }
+    emitBody(frame_size);
+    if (pos >= chunk_start) {
+        // The rest of this chunk goes back through the boundary search
+        return pos - chunk_start;
+    }
+    // The delimiter started in an earlier chunk; carry that prefix over and rescan the whole chunk
+    buffer.assign(reinterpret_cast<const char*>(body.data()) + pos, chunk_start - pos);
+    return 0;
+}
+
+void MjpegStreamParser::reserveBody(size_t size) {
+    // Grows only, so once the largest frame has been seen no further allocation happens
+    if (body.size() < size) {
+        body.resize(size + size / 4);
+    }
+}
+
+void MjpegStreamParser::emitBody(size_t size) {
+    if (size > 0) {
+        frame_count++;
+        frame_bytes_copied = bytes_copied;
+        on_frame(body.data(), size);
+    }
+    bytes_copied = 0;
+    body_size = 0;
+    state = SEEK_BOUNDARY;
+}
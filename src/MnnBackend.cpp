@@ -0,0 +1,109 @@
+#include "MnnBackend.hpp"
+
+#include <iostream>
+
+MnnBackend::MnnBackend(MNN::Interpreter* interpreter, int num_thread)
+    : interpreter(interpreter), num_thread(num_thread) {
+}
+
+MnnBackend::~MnnBackend() {
+    interpreter->releaseModel();
+}
+
+const char* MnnBackend::name() const {
+    return "mnn";
+}
+
+std::unique_ptr<BackendSession> MnnBackend::createSession(int input_width, int input_height, int anchor_count) {
+    MNN::ScheduleConfig config;
+    config.numThread = num_thread;
+    MNN::BackendConfig backendConfig;
+    backendConfig.precision = (MNN::BackendConfig::PrecisionMode) 2;
+    config.backendConfig = &backendConfig;
+
+    std::lock_guard<std::mutex> lock(session_mutex);
+    MNN::Session* session = interpreter->createSession(config);
+    if (!session) {
+        std::cerr << "MNN could not create a session." << std::endl;
+        return nullptr;
+    }
+    return std::unique_ptr<BackendSession>(new MnnSession(*this, session, input_width, input_height, anchor_count));
+}
+
+MnnSession::MnnSession(MnnBackend& owner, MNN::Session* session, int input_width, int input_height,
+                       int anchor_count)
+    : owner(owner), session(session), input_tensor(owner.interpreter->getSessionInput(session, nullptr)),
+      in_w(input_width), in_h(input_height), anchor_count(anchor_count) {
+}
+
+MnnSession::~MnnSession() {
+    std::lock_guard<std::mutex> lock(owner.session_mutex);
+    owner.interpreter->releaseSession(session);
+}
+
+// Re-plans session memory only when the input geometry actually changes
+int MnnSession::resize(int batch) {
+    if (batch == this->batch) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(owner.session_mutex);
+    owner.interpreter->resizeTensor(input_tensor, {batch, 3, in_h, in_w});
+    owner.interpreter->resizeSession(session);
+    // Output tensors may be reallocated by the resize
+    output_scores = owner.interpreter->getSessionOutput(session, "scores");
+    output_boxes = owner.interpreter->getSessionOutput(session, "boxes");
+    scores_host.reset();
+    boxes_host.reset();
+    // resizeSession() has no status; a failed one leaves the tensors unplanned
+    if (!input_tensor || input_tensor->batch() != batch || !output_scores || !output_boxes ||
+        output_scores->elementSize() <= 0 || output_boxes->elementSize() <= 0) {
+        std::cerr << "MNN could not resize the session to batch " << batch << "." << std::endl;
+        this->batch = 0;
+        return -1;
+    }
+    this->batch = batch;
+    return 0;
+}
+
+void MnnSession::writeInput(FusedPreprocessor& preprocessor, const uint8_t* src, int src_w, int src_h,
+                            int src_stride, PixelFormat format, int batch_index) {
+    preprocessor.convert(src, src_w, src_h, src_stride, format, input_tensor, batch_index);
+}
+
+int MnnSession::run() {
+    bytes_copied = 0;
+    return owner.interpreter->runSession(session) == MNN::NO_ERROR ? 0 : -1;
+}
+
+const float* MnnSession::scores() {
+    return outputData(output_scores, scores_host, 2);
+}
+
+const float* MnnSession::boxes() {
+    return outputData(output_boxes, boxes_host, 4);
+}
+
+int MnnSession::outputBatch() const {
+    return output_scores->batch();
+}
+
+size_t MnnSession::outputBytesCopied() const {
+    return bytes_copied;
+}
+
+// CPU backends expose the output in host memory, so a plain (NCHW / NHWC) layout is read in place. Otherwise
+// (GPU backends, or NC4HW4 with its channels packed in fours) it is copied into a host tensor kept across frames.
+const float* MnnSession::outputData(MNN::Tensor* output, std::unique_ptr<MNN::Tensor>& host, int channels) {
+    const float* data = output->host<float>();
+    MNN::Tensor::DimensionType layout = output->getDimensionType();
+    bool plain = layout == MNN::Tensor::CAFFE || layout == MNN::Tensor::TENSORFLOW;
+    if (data && plain && output->elementSize() == batch * anchor_count * channels) {
+        return data;
+    }
+    if (!host) {
+        host.reset(new MNN::Tensor(output, MNN::Tensor::CAFFE));
+    }
+    output->copyToHostTensor(host.get());
+    bytes_copied += host->size();
+    return host->host<float>();
+}
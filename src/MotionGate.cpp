@@ -0,0 +1,70 @@
+#include "MotionGate.hpp"
+
+#include <time.h>
+
+MotionGate::MotionGate(float threshold, int max_skip_ms)
+    : threshold(threshold), max_skip_us(max_skip_ms * 1000LL), small(30, 40, CV_8UC3), thumbnail(30, 40, CV_8UC1),
+      reference(30, 40, CV_8UC1), difference(30, 40, CV_8UC1), last_detect_us(0), frames(0), skipped(0),
+      gate_cpu_us(0), detect_cpu_us(0), detections(0) {}
+
+void MotionGate::setThreshold(float value) {
+    threshold = value;
+}
+
+void MotionGate::setMaxSkipMs(int max_skip_ms) {
+    max_skip_us = max_skip_ms * 1000LL;
+}
+
+bool MotionGate::shouldDetect(const cv::Mat& frame, PixelFormat format, int64_t timestamp_us) {
+    frames++;
+    if (threshold <= 0) {
+        return true;
+    }
+
+    int64_t start = threadCpuTimeUs();
+    cv::resize(frame, small, small.size(), 0, 0, cv::INTER_AREA);
+    cv::cvtColor(small, thumbnail, format == PIXEL_FORMAT_RGB ? cv::COLOR_RGB2GRAY : cv::COLOR_BGR2GRAY);
+
+    bool detect = last_detect_us == 0 || timestamp_us - last_detect_us >= max_skip_us;
+    if (!detect) {
+        cv::absdiff(thumbnail, reference, difference);
+        detect = cv::mean(difference)[0] >= threshold;
+    }
+    if (detect) {
+        std::swap(thumbnail, reference);
+        last_detect_us = timestamp_us;
+    } else {
+        skipped++;
+    }
+    gate_cpu_us += threadCpuTimeUs() - start;
+    return detect;
+}
+
+void MotionGate::recordDetectCpuTime(int64_t cpu_us) {
+    detect_cpu_us += cpu_us;
+    detections++;
+}
+
+MotionGate::Stats MotionGate::getStats() const {
+    Stats stats;
+    stats.frames = frames;
+    stats.skipped = skipped;
+    stats.skip_ratio = stats.frames ? (double) stats.skipped / stats.frames : 0.0;
+    stats.gate_cpu_ms = stats.frames ? gate_cpu_us / 1000.0 / stats.frames : 0.0;
+    uint64_t runs = detections;
+    stats.detect_cpu_ms = runs ? detect_cpu_us / 1000.0 / runs : 0.0;
+    stats.saved_cpu_ms = stats.skipped * stats.detect_cpu_ms - gate_cpu_us / 1000.0;
+    return stats;
+}
+
+int64_t MotionGate::threadCpuTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+int64_t MotionGate::processCpuTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
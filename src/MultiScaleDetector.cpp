@@ -0,0 +1,143 @@
+#include "MultiScaleDetector.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+// Moving down to a smaller size needs this much margin over target_face_px, so a face right at the
+// boundary doesn't flip sizes every frame
+#define SCALE_DOWN_MARGIN 1.25f
+
+MultiScaleDetector::MultiScaleDetector(const std::string& model_path, std::vector<cv::Size> sizes,
+                                       cv::Size base_size, int num_thread, float score_threshold,
+                                       const std::string& backend)
+    : sizes(std::move(sizes)), base(0), last_found(false), last_face_ratio(0), last_score(0),
+      target_face_px(40), min_confidence(0.8f), frames(this->sizes.size()), detect_us(this->sizes.size()) {
+    std::sort(this->sizes.begin(), this->sizes.end(), [](const cv::Size& a, const cv::Size& b) {
+        return a.area() < b.area();
+    });
+    for (size_t i = 0; i < this->sizes.size(); i++) {
+        const cv::Size& size = this->sizes[i];
+        // The model is loaded once; every other size is only a session and anchor table on it
+        if (detectors.empty()) {
+            detectors.emplace_back(new UltraFace(model_path, size.width, size.height, num_thread, score_threshold,
+                                                 0.3, -1, backend));
+        } else {
+            detectors.emplace_back(new UltraFace(*detectors[0], size.width, size.height));
+        }
+        if (size == base_size) {
+            base = i;
+        }
+        frames[i] = 0;
+        detect_us[i] = 0;
+    }
+    last = base;
+}
+
+int MultiScaleDetector::detect(const cv::Mat& img, std::vector<FaceInfo>& faces, PixelFormat format) {
+    if (detectors.empty()) {
+        return -1;
+    }
+    int index = select();
+    UltraFace& detector = *detectors[index];
+    size_t first = faces.size();
+    int status = detector.detect(img, faces, format);
+    last = index;
+
+    const DetectTiming& timing = detector.getLastTiming();
+    frames[index]++;
+    detect_us[index] += (int64_t) ((timing.pre_ms + timing.infer_ms + timing.post_ms) * 1000);
+
+    last_found = false;
+    float max_width = 0;
+    for (size_t i = first; status == 0 && i < faces.size(); i++) {
+        float width = faces[i].x2 - faces[i].x1;
+        if (width > max_width) {
+            max_width = width;
+            last_score = faces[i].score;
+            last_found = true;
+        }
+    }
+    last_face_ratio = max_width / img.cols;
+    return status;
+}
+
+int MultiScaleDetector::select() const {
+    int top = sizes.size() - 1;
+    if (!last_found) {
+        // Nothing ran yet when the base size has no frames, otherwise keep cycling upwards
+        return frames[base] == 0 || last == top ? base : last + 1;
+    }
+
+    int index = top;
+    for (int i = 0; i < top; i++) {
+        if (last_face_ratio * sizes[i].width >= target_face_px) {
+            index = i;
+            break;
+        }
+    }
+    if (index < last && last_face_ratio * sizes[index].width < target_face_px * SCALE_DOWN_MARGIN) {
+        index = std::min(index + 1, last);
+    }
+    if (last_score < min_confidence) {
+        index = std::min(index + 1, top);
+    }
+    return index;
+}
+
+void MultiScaleDetector::setNmsType(int type) {
+    for (auto& detector : detectors) {
+        detector->setNmsType(type);
+    }
+}
+
+void MultiScaleDetector::setTargetFacePx(float px) {
+    target_face_px = px;
+}
+
+void MultiScaleDetector::setMinConfidence(float score) {
+    min_confidence = score;
+}
+
+cv::Size MultiScaleDetector::lastInputSize() const {
+    return sizes.empty() ? cv::Size() : sizes[last];
+}
+
+const DetectTiming& MultiScaleDetector::getLastTiming() const {
+    return detectors[last]->getLastTiming();
+}
+
+size_t MultiScaleDetector::getLastOutputBytesCopied() const {
+    return detectors[last]->getLastOutputBytesCopied();
+}
+
+MultiScaleDetector::Stats MultiScaleDetector::getStats() const {
+    Stats stats;
+    stats.frames = 0;
+    int64_t total_us = 0;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        SizeStats size_stats;
+        size_stats.size = sizes[i];
+        size_stats.frames = frames[i];
+        int64_t us = detect_us[i];
+        size_stats.detect_ms_avg = size_stats.frames ? us / 1000.0 / size_stats.frames : 0;
+        stats.sizes.push_back(size_stats);
+        stats.frames += size_stats.frames;
+        total_us += us;
+    }
+    stats.detect_ms_avg = stats.frames ? total_us / 1000.0 / stats.frames : 0;
+    return stats;
+}
+
+std::vector<cv::Size> MultiScaleDetector::parseSizes(const std::string& text) {
+    std::vector<cv::Size> sizes;
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        int width, height;
+        if (sscanf(item.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+            sizes.emplace_back(width, height);
+        }
+    }
+    return sizes;
+}
@@ -0,0 +1,238 @@
+#include "NmsEngine.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "Simd4.hpp"
+
+// Box i against boxes j..j+3: intersection and union areas, using the +1 pixel convention of the original nms
+#if SIMD4_ENABLED
+static inline void overlap4(const float* x1, const float* y1, const float* x2, const float* y2, const float* area,
+                            int i, int j, v4f* inter, v4f* uni) {
+    v4f w = vadd(vsub(vmin(vset(x2[i]), vload(x2 + j)), vmax(vset(x1[i]), vload(x1 + j))), vset(1));
+    v4f h = vadd(vsub(vmin(vset(y2[i]), vload(y2 + j)), vmax(vset(y1[i]), vload(y1 + j))), vset(1));
+    *inter = vmul(vmax(w, vset(0)), vmax(h, vset(0)));
+    *uni = vsub(vadd(vset(area[i]), vload(area + j)), *inter);
+}
+#else
+static inline void overlap1(const float* x1, const float* y1, const float* x2, const float* y2, const float* area,
+                            int i, int j, float* inter, float* uni) {
+    float w = std::min(x2[i], x2[j]) - std::max(x1[i], x1[j]) + 1;
+    float h = std::min(y2[i], y2[j]) - std::max(y1[i], y1[j]) + 1;
+    *inter = std::max(w, 0.0f) * std::max(h, 0.0f);
+    *uni = area[i] + area[j] - *inter;
+}
+#endif
+
+NmsEngine::NmsEngine(float iou_threshold, int topk, float score_threshold, float soft_sigma)
+    : iou_threshold(iou_threshold), topk(topk), score_threshold(score_threshold), soft_sigma(soft_sigma), count(0) {
+}
+
+void NmsEngine::setTopK(int topk) {
+    this->topk = topk;
+}
+
+void NmsEngine::setIouThreshold(float threshold) {
+    iou_threshold = threshold;
+}
+
+const char* NmsEngine::typeName(int type) {
+    switch (type) {
+        case hard_nms: return "hard";
+        case blending_nms: return "blending";
+        case fast_nms: return "fast";
+        case soft_nms: return "soft";
+        default: return "unknown";
+    }
+}
+
+int NmsEngine::typeFromName(const char* name) {
+    for (int type = hard_nms; type <= soft_nms; type++) {
+        if (strcmp(name, typeName(type)) == 0) {
+            return type;
+        }
+    }
+    return -1;
+}
+
+int NmsEngine::run(const std::vector<FaceInfo>& input, std::vector<FaceInfo>& output, int type) {
+    if (type < hard_nms || type > soft_nms) {
+        std::cerr << "Unknown NMS type " << type << std::endl;
+        return -1;
+    }
+    load(input);
+    switch (type) {
+        case hard_nms: hard(output); break;
+        case blending_nms: blending(output); break;
+        case fast_nms: fast(output); break;
+        case soft_nms: soft(output); break;
+    }
+    return 0;
+}
+
+void NmsEngine::load(const std::vector<FaceInfo>& input) {
+    int n = input.size();
+    order.resize(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    auto by_score = [&input](int a, int b) { return input[a].score > input[b].score; };
+    if (topk > 0 && n > topk) {
+        std::partial_sort(order.begin(), order.begin() + topk, order.end(), by_score);
+        n = topk;
+    } else {
+        std::sort(order.begin(), order.end(), by_score);
+    }
+    count = n;
+
+    // Three lanes of padding so a 4-wide load starting at any box stays in bounds. Padding boxes are empty
+    // (x2 < x1) and never overlap anything.
+    int padded = n + 3;
+    x1.resize(padded);
+    y1.resize(padded);
+    x2.resize(padded);
+    y2.resize(padded);
+    area.resize(padded);
+    score.resize(padded);
+    suppressed.assign(padded, 0);
+    for (int i = 0; i < padded; i++) {
+        if (i < n) {
+            const FaceInfo& box = input[order[i]];
+            x1[i] = box.x1;
+            y1[i] = box.y1;
+            x2[i] = box.x2;
+            y2[i] = box.y2;
+            score[i] = box.score;
+            area[i] = (box.x2 - box.x1 + 1) * (box.y2 - box.y1 + 1);
+        } else {
+            x1[i] = y1[i] = 0;
+            x2[i] = y2[i] = -1;
+            score[i] = area[i] = 0;
+        }
+    }
+}
+
+int NmsEngine::overlapMask(int i, int j) const {
+    int mask = 0;
+#if SIMD4_ENABLED
+    v4f inter, uni;
+    overlap4(x1.data(), y1.data(), x2.data(), y2.data(), area.data(), i, j, &inter, &uni);
+    // inter / union > threshold, without the divide
+    mask = vgtmask(inter, vmul(uni, vset(iou_threshold)));
+#else
+    for (int k = 0; k < 4; k++) {
+        float inter, uni;
+        overlap1(x1.data(), y1.data(), x2.data(), y2.data(), area.data(), i, j + k, &inter, &uni);
+        mask |= (inter > uni * iou_threshold) << k;
+    }
+#endif
+    if (j + 4 > count) {
+        mask &= (1 << std::max(count - j, 0)) - 1;
+    }
+    return mask;
+}
+
+void NmsEngine::hard(std::vector<FaceInfo>& output) {
+    for (int i = 0; i < count; i++) {
+        if (suppressed[i]) {
+            continue;
+        }
+        output.push_back({x1[i], y1[i], x2[i], y2[i], score[i]});
+        for (int j = i + 1; j < count; j += 4) {
+            for (int mask = overlapMask(i, j); mask; mask &= mask - 1) {
+                suppressed[j + __builtin_ctz(mask)] = 1;
+            }
+        }
+    }
+}
+
+void NmsEngine::blending(std::vector<FaceInfo>& output) {
+    for (int i = 0; i < count; i++) {
+        if (suppressed[i]) {
+            continue;
+        }
+        cluster.clear();
+        cluster.push_back(i);
+        for (int j = i + 1; j < count; j += 4) {
+            for (int mask = overlapMask(i, j); mask; mask &= mask - 1) {
+                int k = j + __builtin_ctz(mask);
+                if (!suppressed[k]) {
+                    suppressed[k] = 1;
+                    cluster.push_back(k);
+                }
+            }
+        }
+
+        float total = 0;
+        for (int k : cluster) {
+            total += exp(score[k]);
+        }
+        FaceInfo rects = {0, 0, 0, 0, 0};
+        for (int k : cluster) {
+            float rate = exp(score[k]) / total;
+            rects.x1 += x1[k] * rate;
+            rects.y1 += y1[k] * rate;
+            rects.x2 += x2[k] * rate;
+            rects.y2 += y2[k] * rate;
+            rects.score += score[k] * rate;
+        }
+        output.push_back(rects);
+    }
+}
+
+// Every box is tested against every higher-scoring box, suppressed or not: the column-wise maximum of the
+// upper-triangular IoU matrix, evaluated row by row so no matrix is stored
+void NmsEngine::fast(std::vector<FaceInfo>& output) {
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j += 4) {
+            for (int mask = overlapMask(i, j); mask; mask &= mask - 1) {
+                suppressed[j + __builtin_ctz(mask)] = 1;
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (!suppressed[i]) {
+            output.push_back({x1[i], y1[i], x2[i], y2[i], score[i]});
+        }
+    }
+}
+
+void NmsEngine::soft(std::vector<FaceInfo>& output) {
+    float inv_sigma = 1.0f / soft_sigma;
+    while (true) {
+        int best = -1;
+        for (int i = 0; i < count; i++) {
+            if (!suppressed[i] && (best < 0 || score[i] > score[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        suppressed[best] = 1;
+        output.push_back({x1[best], y1[best], x2[best], y2[best], score[best]});
+
+        // score *= exp(-iou^2 / sigma) for every remaining box
+        for (int j = 0; j < count; j += 4) {
+#if SIMD4_ENABLED
+            v4f inter, uni;
+            overlap4(x1.data(), y1.data(), x2.data(), y2.data(), area.data(), best, j, &inter, &uni);
+            v4f iou = vdiv(inter, vmax(uni, vset(1e-6f)));
+            vstore(score.data() + j, vmul(vload(score.data() + j), vexp(vmul(vmul(iou, iou), vset(-inv_sigma)))));
+#else
+            for (int k = j; k < j + 4; k++) {
+                float inter, uni;
+                overlap1(x1.data(), y1.data(), x2.data(), y2.data(), area.data(), best, k, &inter, &uni);
+                float iou = inter / std::max(uni, 1e-6f);
+                score[k] *= std::exp(-iou * iou * inv_sigma);
+            }
+#endif
+        }
+        for (int j = 0; j < count; j++) {
+            if (score[j] <= score_threshold) {
+                suppressed[j] = 1;
+            }
+        }
+    }
+}
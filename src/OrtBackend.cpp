@@ -0,0 +1,141 @@
+#ifdef USE_ONNXRUNTIME
+
+#include "OrtBackend.hpp"
+
+#include <iostream>
+#include "FaceDecodeNmsOp.hpp"
+
+static Ort::SessionOptions sessionOptions(int num_thread) {
+    Ort::SessionOptions options;
+    options.SetIntraOpNumThreads(num_thread);
+    options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+    addFaceOps(options);
+    return options;
+}
+
+OrtBackend::OrtBackend(const std::string& model_path, int num_thread)
+    : env(ORT_LOGGING_LEVEL_WARNING, "ultraface"), session(env, model_path.c_str(), sessionOptions(num_thread)),
+      memory_info(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {
+    Ort::AllocatorWithDefaultOptions allocator;
+    input_name = session.GetInputNameAllocated(0, allocator).get();
+
+    std::vector<int64_t> shape = session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    if (shape.size() != 4) {
+        throw Ort::Exception("model input is not N x 3 x H x W", ORT_INVALID_ARGUMENT);
+    }
+    fixed_batch = shape[0] > 0 ? (int) shape[0] : 0;
+    fixed_h = shape[2] > 0 ? (int) shape[2] : 0;
+    fixed_w = shape[3] > 0 ? (int) shape[3] : 0;
+
+    fused = false;
+    for (size_t i = 0; i < session.GetOutputCount(); i++) {
+        fused |= std::string(session.GetOutputNameAllocated(i, allocator).get()) == "faces";
+    }
+}
+
+const char* OrtBackend::name() const {
+    return "onnx";
+}
+
+std::unique_ptr<BackendSession> OrtBackend::createSession(int input_width, int input_height, int anchor_count) {
+    if ((fixed_w && fixed_w != input_width) || (fixed_h && fixed_h != input_height)) {
+        std::cerr << "ONNX model input is fixed at " << fixed_w << "x" << fixed_h << ", not " << input_width << "x"
+                  << input_height << std::endl;
+        return nullptr;
+    }
+    return std::unique_ptr<BackendSession>(new OrtSession(*this, input_width, input_height, anchor_count));
+}
+
+OrtSession::OrtSession(OrtBackend& owner, int input_width, int input_height, int anchor_count)
+    : owner(owner), binding(owner.session), in_w(input_width), in_h(input_height), anchor_count(anchor_count) {
+}
+
+// Buffers and bindings are rebuilt only when the batch changes; every run after that reuses them as they are
+int OrtSession::resize(int batch) {
+    if (batch == this->batch) {
+        return 0;
+    }
+    if (owner.fixed_batch && batch != owner.fixed_batch) {
+        return -1;
+    }
+    int64_t input_shape[] = {batch, 3, in_h, in_w};
+    int64_t scores_shape[] = {batch, anchor_count, 2};
+    int64_t boxes_shape[] = {batch, anchor_count, 4};
+    input.assign((size_t) batch * 3 * in_h * in_w, 0);
+    try {
+        binding.ClearBoundInputs();
+        binding.ClearBoundOutputs();
+        binding.BindInput(owner.input_name.c_str(),
+                          Ort::Value::CreateTensor<float>(owner.memory_info, input.data(), input.size(), input_shape, 4));
+        if (owner.fused) {
+            int64_t sizes_shape[] = {batch, 2};
+            image_sizes.assign((size_t) batch * 2, 0);
+            binding.BindInput("image_sizes", Ort::Value::CreateTensor<float>(owner.memory_info, image_sizes.data(),
+                                                                             image_sizes.size(), sizes_shape, 2));
+            binding.BindOutput("faces", owner.memory_info);
+        } else {
+            scores_data.assign((size_t) batch * anchor_count * 2, 0);
+            boxes_data.assign((size_t) batch * anchor_count * 4, 0);
+            binding.BindOutput("scores", Ort::Value::CreateTensor<float>(owner.memory_info, scores_data.data(),
+                                                                         scores_data.size(), scores_shape, 3));
+            binding.BindOutput("boxes", Ort::Value::CreateTensor<float>(owner.memory_info, boxes_data.data(),
+                                                                        boxes_data.size(), boxes_shape, 3));
+        }
+    } catch (const Ort::Exception& e) {
+        std::cerr << "ONNX Runtime binding failed: " << e.what() << std::endl;
+        this->batch = 0;
+        return -1;
+    }
+    this->batch = batch;
+    return 0;
+}
+
+void OrtSession::writeInput(FusedPreprocessor& preprocessor, const uint8_t* src, int src_w, int src_h,
+                            int src_stride, PixelFormat format, int batch_index) {
+    size_t plane = (size_t) in_w * in_h;
+    preprocessor.run(src, src_w, src_h, src_stride, format == PIXEL_FORMAT_BGR, input.data() + batch_index * 3 * plane,
+                     in_w, in_h, false);
+    if (owner.fused) {
+        image_sizes[batch_index * 2] = src_w;
+        image_sizes[batch_index * 2 + 1] = src_h;
+    }
+}
+
+int OrtSession::run() {
+    try {
+        owner.session.Run(Ort::RunOptions{nullptr}, binding);
+        if (owner.fused) {
+            faces = std::move(binding.GetOutputValues()[0]);
+        }
+    } catch (const Ort::Exception& e) {
+        std::cerr << "ONNX Runtime run failed: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+const float* OrtSession::scores() {
+    return scores_data.data();
+}
+
+const float* OrtSession::boxes() {
+    return boxes_data.data();
+}
+
+int OrtSession::outputBatch() const {
+    return batch;
+}
+
+int OrtSession::fusedFaces(const float** rows) {
+    if (!owner.fused) {
+        return -1;
+    }
+    *rows = faces.GetTensorData<float>();
+    return (int) faces.GetTensorTypeAndShapeInfo().GetShape()[0];
+}
+
+size_t OrtSession::outputBytesCopied() const {
+    return 0;
+}
+
+#endif // USE_ONNXRUNTIME
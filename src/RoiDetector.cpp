@@ -0,0 +1,146 @@
+#include "RoiDetector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// A window covering this much of the frame in either direction saves too little, the full scan runs instead
+#define ROI_MAX_FRAME_FRACTION 0.8f
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RoiDetector::RoiDetector(const std::string& model_path, cv::Size full_input, cv::Size roi_input,
+                         int full_scan_interval, int num_thread, float score_threshold, const std::string& backend)
+    : full(model_path, full_input.width, full_input.height, num_thread, score_threshold, 0.3, -1, backend),
+      roi(full, roi_input.width, roi_input.height),
+      roi_input(roi_input), full_scan_interval(full_scan_interval), margin(1.0f), tracking(false),
+      target({0, 0, 0, 0, 0}), frames_since_full(0), last_detector(&full), lost_us(0), full_frames(0), roi_frames(0),
+      losses(0), reacquisitions(0), full_us(0), roi_us(0), reacquire_us_total(0), reacquire_us_max(0) {
+}
+
+int RoiDetector::detect(const cv::Mat& frame, std::vector<FaceInfo>& faces, PixelFormat format) {
+    if (!tracking || frames_since_full >= full_scan_interval) {
+        return runFull(frame, faces, format);
+    }
+    cv::Rect rect = window(frame);
+    if (rect.empty()) {
+        return runFull(frame, faces, format);
+    }
+
+    size_t first = faces.size();
+    int status = roi.detect(frame(rect), faces, format);
+    last_detector = &roi;
+    last_window = rect;
+    frames_since_full++;
+    roi_frames++;
+    roi_us += (int64_t) (detectMs(roi) * 1000);
+    for (size_t i = first; i < faces.size(); i++) {
+        faces[i].x1 += rect.x;
+        faces[i].x2 += rect.x;
+        faces[i].y1 += rect.y;
+        faces[i].y2 += rect.y;
+    }
+    if (status == 0 && track(faces, first)) {
+        return 0;
+    }
+
+    // The face left the window: scan the whole frame now rather than report nothing
+    losses++;
+    lost_us = nowUs();
+    faces.resize(first);
+    return runFull(frame, faces, format);
+}
+
+int RoiDetector::runFull(const cv::Mat& frame, std::vector<FaceInfo>& faces, PixelFormat format) {
+    size_t first = faces.size();
+    int status = full.detect(frame, faces, format);
+    last_detector = &full;
+    last_window = cv::Rect();
+    frames_since_full = 0;
+    full_frames++;
+    full_us += (int64_t) (detectMs(full) * 1000);
+
+    bool was_tracking = tracking;
+    tracking = status == 0 && track(faces, first);
+    if (tracking && lost_us) {
+        int64_t latency = nowUs() - lost_us;
+        reacquisitions++;
+        reacquire_us_total += latency;
+        reacquire_us_max = std::max<int64_t>(reacquire_us_max, latency);
+        lost_us = 0;
+    } else if (!tracking && was_tracking && !lost_us) {
+        // Lost on a periodic full scan rather than in the window
+        losses++;
+        lost_us = nowUs();
+    }
+    return status;
+}
+
+bool RoiDetector::track(const std::vector<FaceInfo>& faces, size_t first) {
+    float max_width = 0;
+    for (size_t i = first; i < faces.size(); i++) {
+        float width = faces[i].x2 - faces[i].x1;
+        if (width > max_width) {
+            max_width = width;
+            target = faces[i];
+        }
+    }
+    return max_width > 0;
+}
+
+cv::Rect RoiDetector::window(const cv::Mat& frame) const {
+    float aspect = roi_input.width / (float) roi_input.height;
+    float face_w = target.x2 - target.x1;
+    float face_h = target.y2 - target.y1;
+    int w = (int) std::lround(std::max(std::max(face_w, face_h * aspect) * (1 + 2 * margin), roi_input.width * 0.5f));
+    int h = (int) std::lround(w / aspect);
+    if (w >= frame.cols * ROI_MAX_FRAME_FRACTION || h >= frame.rows * ROI_MAX_FRAME_FRACTION) {
+        return cv::Rect();
+    }
+    // Centered on the face, shifted rather than clipped at the frame edges so the size stays the same
+    int x = std::min(std::max((int) ((target.x1 + target.x2 - w) / 2), 0), frame.cols - w);
+    int y = std::min(std::max((int) ((target.y1 + target.y2 - h) / 2), 0), frame.rows - h);
+    return cv::Rect(x, y, w, h);
+}
+
+float RoiDetector::detectMs(const UltraFace& detector) {
+    const DetectTiming& timing = detector.getLastTiming();
+    return timing.pre_ms + timing.infer_ms + timing.post_ms;
+}
+
+void RoiDetector::setNmsType(int type) {
+    full.setNmsType(type);
+    roi.setNmsType(type);
+}
+
+void RoiDetector::setMargin(float margin) {
+    this->margin = margin;
+}
+
+bool RoiDetector::isTracking() const {
+    return tracking;
+}
+
+cv::Rect RoiDetector::lastWindow() const {
+    return last_window;
+}
+
+size_t RoiDetector::getLastOutputBytesCopied() const {
+    return last_detector->getLastOutputBytesCopied();
+}
+
+RoiDetector::Stats RoiDetector::getStats() const {
+    Stats stats;
+    stats.full_frames = full_frames;
+    stats.roi_frames = roi_frames;
+    stats.losses = losses;
+    stats.full_ms_avg = stats.full_frames ? full_us / 1000.0 / stats.full_frames : 0;
+    stats.roi_ms_avg = stats.roi_frames ? roi_us / 1000.0 / stats.roi_frames : 0;
+    uint64_t count = reacquisitions;
+    stats.reacquire_ms_avg = count ? reacquire_us_total / 1000.0 / count : 0;
+    stats.reacquire_ms_max = reacquire_us_max / 1000.0;
+    return stats;
+}
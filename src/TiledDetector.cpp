@@ -0,0 +1,157 @@
+#include "TiledDetector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+
+// A box within this many pixels of a tile edge was cut off by it
+#define TILE_EDGE_PX 1.0f
+
+TiledDetector::TiledDetector(const std::string& model_path, cv::Size input, float overlap, int sessions,
+                             int num_thread, float score_threshold, const std::string& backend)
+    : detector(model_path, input.width, input.height, num_thread, score_threshold, 0.3, -1, backend),
+      input(input), overlap(std::min(std::max(overlap, 0.0f), 0.9f)), full_frame(true), nms_type(blending_nms),
+      merge_engine(0.3), frames(0), tiles(0), detect_us(0), faces_total(0) {
+    if (sessions > 1) {
+        pool.reset(new DetectorPool(detector, sessions));
+        // Without pooled sessions the tiles still run as one batch on the detector's own
+        if (pool->getSessionCount() == 0) {
+            pool.reset();
+        }
+    }
+}
+
+// Evenly spread starts of tile-long spans covering length, with neighbours sharing at least overlap * tile
+std::vector<int> TiledDetector::tileOffsets(int length, int tile, float overlap) {
+    if (length <= tile) {
+        return {0};
+    }
+    float stride = std::max(tile * (1 - overlap), 1.0f);
+    int count = (int) std::ceil((length - tile) / stride) + 1;
+    std::vector<int> offsets;
+    for (int i = 0; i < count; i++) {
+        offsets.push_back((int) std::lround((double) i * (length - tile) / (count - 1)));
+    }
+    return offsets;
+}
+
+std::vector<cv::Rect> TiledDetector::tileRects(cv::Size frame) const {
+    int tile_w = std::min(input.width, frame.width);
+    int tile_h = std::min(input.height, frame.height);
+    std::vector<cv::Rect> rects;
+    for (int y : tileOffsets(frame.height, tile_h, overlap)) {
+        for (int x : tileOffsets(frame.width, tile_w, overlap)) {
+            rects.emplace_back(x, y, tile_w, tile_h);
+        }
+    }
+    return rects;
+}
+
+bool TiledDetector::heldWhole(const std::vector<cv::Rect>& tiles, size_t except, const FaceInfo& face) {
+    for (size_t i = 0; i < tiles.size(); i++) {
+        const cv::Rect& tile = tiles[i];
+        if (i != except && face.x1 >= tile.x && face.y1 >= tile.y && face.x2 <= tile.x + tile.width &&
+            face.y2 <= tile.y + tile.height) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int TiledDetector::detect(const cv::Mat& frame, std::vector<FaceInfo>& faces, PixelFormat format) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<cv::Rect> rects = tileRects(frame.size());
+    size_t tile_count = rects.size();
+    images.clear();
+    for (const cv::Rect& rect : rects) {
+        images.push_back(frame(rect));
+    }
+    // A frame that fits in one tile already ran whole
+    if (full_frame && tile_count > 1) {
+        images.push_back(frame);
+        rects.emplace_back(0, 0, frame.cols, frame.rows);
+    }
+    if (detectTiles(images, format) != 0) {
+        return -1;
+    }
+
+    std::vector<cv::Rect> grid(rects.begin(), rects.begin() + tile_count);
+    candidates.clear();
+    for (size_t i = 0; i < rects.size(); i++) {
+        const cv::Rect& rect = rects[i];
+        bool inner_left = rect.x > 0, inner_right = rect.x + rect.width < frame.cols;
+        bool inner_top = rect.y > 0, inner_bottom = rect.y + rect.height < frame.rows;
+        for (FaceInfo face : tile_faces[i]) {
+            bool cut = (inner_left && face.x1 <= TILE_EDGE_PX) ||
+                       (inner_right && face.x2 >= rect.width - TILE_EDGE_PX) ||
+                       (inner_top && face.y1 <= TILE_EDGE_PX) ||
+                       (inner_bottom && face.y2 >= rect.height - TILE_EDGE_PX);
+            face.x1 += rect.x;
+            face.x2 += rect.x;
+            face.y1 += rect.y;
+            face.y2 += rect.y;
+            // A truncated box would only blur the whole one in the merge
+            if (cut && heldWhole(grid, i, face)) {
+                continue;
+            }
+            candidates.push_back(face);
+        }
+    }
+    size_t first = faces.size();
+    merge_engine.run(candidates, faces, nms_type);
+
+    frames++;
+    tiles = rects.size();
+    faces_total += faces.size() - first;
+    detect_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return 0;
+}
+
+int TiledDetector::detectTiles(const std::vector<cv::Mat>& images, PixelFormat format) {
+    if (!pool) {
+        return detector.detectBatch(images, tile_faces, format);
+    }
+    tile_faces.resize(images.size());
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining = images.size();
+    int status = 0;
+    for (size_t i = 0; i < images.size(); i++) {
+        pool->submit(images[i], format, [&, i](int tile_status, const std::vector<FaceInfo>& faces) {
+            std::lock_guard<std::mutex> lock(mutex);
+            tile_faces[i] = faces;
+            status |= tile_status;
+            // Notified under the lock, so the waiter can't return and destroy done first
+            if (--remaining == 0) {
+                done.notify_one();
+            }
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return remaining == 0; });
+    return status ? -1 : 0;
+}
+
+void TiledDetector::setNmsType(int type) {
+    detector.setNmsType(type);
+    nms_type = type;
+}
+
+void TiledDetector::setFullFrame(bool enable) {
+    full_frame = enable;
+}
+
+size_t TiledDetector::getLastOutputBytesCopied() const {
+    return pool ? 0 : detector.getLastOutputBytesCopied();
+}
+
+TiledDetector::Stats TiledDetector::getStats() const {
+    Stats stats;
+    stats.frames = frames;
+    stats.tiles = tiles;
+    stats.detect_ms_avg = stats.frames ? detect_us / 1000.0 / stats.frames : 0;
+    stats.faces_avg = stats.frames ? (double) faces_total / stats.frames : 0;
+    return stats;
+}
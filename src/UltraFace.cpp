@@ -1,220 +1,225 @@
 //  Created by Linzaer on 2019/11/15.
 //  Copyright © 2019 Linzaer. All rights reserved.
 
-#define clip(x, y) (x < 0 ? 0 : (x > y ? y : x))
-
 #include "UltraFace.hpp"
 
 using namespace std;
 
-UltraFace::UltraFace(const std::string &mnn_path,
+UltraFace::UltraFace(const std::string &model_path,
                      int input_width, int input_length, int num_thread_,
-                     float score_threshold_, float iou_threshold_, int topk_) {
+                     float score_threshold_, float iou_threshold_, int topk_, const std::string &backend_type)
+        : batch_folded(false), anchors(input_width, input_length), decoder(anchors, center_variance, size_variance) {
     num_thread = num_thread_;
     score_threshold = score_threshold_;
     iou_threshold = iou_threshold_;
+    topk = topk_;
     in_w = input_width;
     in_h = input_length;
-    w_h_list = {in_w, in_h};
-
-    for (auto size : w_h_list) {
-        std::vector<float> fm_item;
-        for (float stride : strides) {
-            fm_item.push_back(ceil(size / stride));
-        }
-        featuremap_size.push_back(fm_item);
-    }
-
-    for (auto size : w_h_list) {
-        shrinkage_size.push_back(strides);
-    }
-    /* generate prior anchors */
-    for (int index = 0; index < num_featuremap; index++) {
-        float scale_w = in_w / shrinkage_size[0][index];
-        float scale_h = in_h / shrinkage_size[1][index];
-        for (int j = 0; j < featuremap_size[1][index]; j++) {
-            for (int i = 0; i < featuremap_size[0][index]; i++) {
-                float x_center = (i + 0.5) / scale_w;
-                float y_center = (j + 0.5) / scale_h;
-
-                for (float k : min_boxes[index]) {
-                    float w = k / in_w;
-                    float h = k / in_h;
-                    priors.push_back({clip(x_center, 1), clip(y_center, 1), clip(w, 1), clip(h, 1)});
-                }
-            }
-        }
-    }
-    /* generate prior anchors finished */
-
-    num_anchors = priors.size();
 
-    ultraface_interpreter = std::shared_ptr<MNN::Interpreter>(MNN::Interpreter::createFromFile(mnn_path.c_str()));
-    MNN::ScheduleConfig config;
-    config.numThread = num_thread;
-    MNN::BackendConfig backendConfig;
-    backendConfig.precision = (MNN::BackendConfig::PrecisionMode) 2;
-    config.backendConfig = &backendConfig;
+    backend = DetectorBackend::create(model_path, backend_type, num_thread);
 
-    ultraface_session = ultraface_interpreter->createSession(config);
-
-    input_tensor = ultraface_interpreter->getSessionInput(ultraface_session, nullptr);
+    default_context = createContext();
+}
 
+UltraFace::UltraFace(const UltraFace &model, int input_width, int input_length)
+        : backend(model.backend), batch_folded(false), num_thread(model.num_thread), in_w(input_width),
+          in_h(input_length), score_threshold(model.score_threshold), iou_threshold(model.iou_threshold),
+          topk(model.topk), anchors(input_width, input_length), decoder(anchors, center_variance, size_variance),
+          nms_type(model.nms_type), bilinear(model.bilinear) {
+    default_context = createContext();
 }
 
 UltraFace::~UltraFace() {
-    ultraface_interpreter->releaseModel();
-    ultraface_interpreter->releaseSession(ultraface_session);
+    default_context.reset();
 }
 
-int UltraFace::detect(cv::Mat &raw_image, std::vector<FaceInfo> &face_list) {
-    if (raw_image.empty()) {
-        std::cout << "image is empty ,please check!" << std::endl;
-        return -1;
+std::unique_ptr<UltraFaceContext> UltraFace::createContext() {
+    if (!backend) {
+        return nullptr;
     }
+    std::unique_ptr<BackendSession> session = backend->createSession(in_w, in_h, anchors.size());
+    if (!session || session->resize(1) != 0) {
+        return nullptr;
+    }
+    std::unique_ptr<UltraFaceContext> context(
+            new UltraFaceContext(std::move(session), mean_vals, norm_vals,
+                                 NmsEngine(iou_threshold, topk, score_threshold)));
+
+    // Warm-up: the first inference pays for lazy allocations and cache misses, keep that off real frames
+    cv::Mat blank = cv::Mat::zeros(in_h, in_w, CV_8UC3);
+    std::vector<FaceInfo> warmup_faces;
+    detect(*context, blank, warmup_faces);
+    return context;
+}
 
-    image_h = raw_image.rows;
-    image_w = raw_image.cols;
-    cv::Mat image;
-    cv::resize(raw_image, image, cv::Size(in_w, in_h));
-
-    ultraface_interpreter->resizeTensor(input_tensor, {1, 3, in_h, in_w});
-    ultraface_interpreter->resizeSession(ultraface_session);
-    std::shared_ptr<MNN::CV::ImageProcess> pretreat(
-            MNN::CV::ImageProcess::create(MNN::CV::BGR, MNN::CV::RGB, mean_vals, 3,
-                                          norm_vals, 3));
-    pretreat->convert(image.data, in_w, in_h, image.step[0], input_tensor);
-
-    //auto start = chrono::steady_clock::now();
-
+int UltraFace::detect(const cv::Mat &raw_image, std::vector<FaceInfo> &face_list, PixelFormat format) {
+    if (!default_context) {
+        return -1;
+    }
+    return detect(*default_context, raw_image, face_list, format);
+}
 
-    // run network
-    ultraface_interpreter->runSession(ultraface_session);
+int UltraFace::detect(UltraFaceContext &context, const cv::Mat &raw_image, std::vector<FaceInfo> &face_list,
+                      PixelFormat format) const {
+    return run(context, &raw_image, 1, &face_list, format);
+}
 
-    // get output data
+int UltraFace::detectBatch(const std::vector<cv::Mat> &images, std::vector<std::vector<FaceInfo>> &face_lists,
+                           PixelFormat format) {
+    if (!default_context) {
+        return -1;
+    }
+    return detectBatch(*default_context, images, face_lists, format);
+}
 
-    string scores = "scores";
-    string boxes = "boxes";
-    MNN::Tensor *tensor_scores = ultraface_interpreter->getSessionOutput(ultraface_session, scores.c_str());
-    MNN::Tensor *tensor_boxes = ultraface_interpreter->getSessionOutput(ultraface_session, boxes.c_str());
+int UltraFace::detectBatch(UltraFaceContext &context, const std::vector<cv::Mat> &images,
+                           std::vector<std::vector<FaceInfo>> &face_lists, PixelFormat format) const {
+    face_lists.resize(images.size());
+    if (images.empty()) {
+        return 0;
+    }
+    if (!batch_folded) {
+        int status = run(context, images.data(), images.size(), face_lists.data(), format);
+        if (status == 0 || !batch_folded) {
+            return status;
+        }
+    }
+    for (size_t i = 0; i < images.size(); i++) {
+        if (run(context, &images[i], 1, &face_lists[i], format) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
 
-    MNN::Tensor tensor_scores_host(tensor_scores, tensor_scores->getDimensionType());
+int UltraFace::run(UltraFaceContext &context, const cv::Mat *images, int count, std::vector<FaceInfo> *face_lists,
+                   PixelFormat format) const {
+    if (preprocess(context, images, count, format) != 0 || infer(context) != 0) {
+        return -1;
+    }
+    return postprocess(context, face_lists);
+}
 
-    tensor_scores->copyToHostTensor(&tensor_scores_host);
+int UltraFace::preprocess(UltraFaceContext &context, const cv::Mat *images, int count, PixelFormat format) const {
+    for (int i = 0; i < count; i++) {
+        if (images[i].empty()) {
+            std::cout << "image is empty ,please check!" << std::endl;
+            return -1;
+        }
+    }
 
-    MNN::Tensor tensor_boxes_host(tensor_boxes, tensor_boxes->getDimensionType());
+    auto start = chrono::steady_clock::now();
 
-    tensor_boxes->copyToHostTensor(&tensor_boxes_host);
+    if (context.session->resize(count) != 0) {
+        // The exported graph has a fixed batch
+        if (count > 1 && !batch_folded.exchange(true)) {
+            std::cerr << "Model input is not batched, falling back to one image per run." << std::endl;
+        }
+        return -1;
+    }
+    context.image_sizes.resize(count);
+    context.preprocessor.setBilinear(bilinear);
+    for (int i = 0; i < count; i++) {
+        context.session->writeInput(context.preprocessor, images[i].data, images[i].cols, images[i].rows,
+                                    images[i].step[0], format, i);
+        context.image_sizes[i] = images[i].size();
+    }
 
-    std::vector<FaceInfo> bbox_collection;
+    context.last_timing.pre_ms = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+    return 0;
+}
 
+int UltraFace::infer(UltraFaceContext &context) const {
+    auto start = chrono::steady_clock::now();
 
-    //auto end = chrono::steady_clock::now();
-    //chrono::duration<double> elapsed = end - start;
+    // run network
+    int status = context.session->run();
 
-    generateBBox(bbox_collection, tensor_scores, tensor_boxes);
-    nms(bbox_collection, face_list);
-    return 0;
+    context.last_timing.infer_ms = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+    return status;
 }
 
-void UltraFace::generateBBox(std::vector<FaceInfo> &bbox_collection, MNN::Tensor *scores, MNN::Tensor *boxes) {
-    for (int i = 0; i < num_anchors; i++) {
-        if (scores->host<float>()[i * 2 + 1] > score_threshold) {
-            FaceInfo rects;
-            float x_center = boxes->host<float>()[i * 4] * center_variance * priors[i][2] + priors[i][0];
-            float y_center = boxes->host<float>()[i * 4 + 1] * center_variance * priors[i][3] + priors[i][1];
-            float w = exp(boxes->host<float>()[i * 4 + 2] * size_variance) * priors[i][2];
-            float h = exp(boxes->host<float>()[i * 4 + 3] * size_variance) * priors[i][3];
-
-            rects.x1 = clip(x_center - w / 2.0, 1) * image_w;
-            rects.y1 = clip(y_center - h / 2.0, 1) * image_h;
-            rects.x2 = clip(x_center + w / 2.0, 1) * image_w;
-            rects.y2 = clip(y_center + h / 2.0, 1) * image_h;
-            rects.score = clip(scores->host<float>()[i * 2 + 1], 1);
-            bbox_collection.push_back(rects);
+int UltraFace::postprocess(UltraFaceContext &context, std::vector<FaceInfo> *face_lists) const {
+    auto start = chrono::steady_clock::now();
+    int count = context.image_sizes.size();
+
+    // Graphs exported with FaceDecodeNms have already decoded and suppressed, with the thresholds baked into them
+    const float *rows;
+    int fused = context.session->fusedFaces(&rows);
+    if (fused >= 0) {
+        for (int r = 0; r < fused; r++, rows += 6) {
+            int image = (int) rows[0];
+            if (image >= 0 && image < count) {
+                face_lists[image].push_back({rows[1], rows[2], rows[3], rows[4], rows[5]});
+            }
         }
+        context.output_bytes_copied = 0;
+        context.last_timing.post_ms = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+        return 0;
     }
-}
 
-void UltraFace::nms(std::vector<FaceInfo> &input, std::vector<FaceInfo> &output, int type) {
-    std::sort(input.begin(), input.end(), [](const FaceInfo &a, const FaceInfo &b) { return a.score > b.score; });
-
-    int box_num = input.size();
-
-    std::vector<int> merged(box_num, 0);
-
-    for (int i = 0; i < box_num; i++) {
-        if (merged[i])
-            continue;
-        std::vector<FaceInfo> buf;
-
-        buf.push_back(input[i]);
-        merged[i] = 1;
-
-        float h0 = input[i].y2 - input[i].y1 + 1;
-        float w0 = input[i].x2 - input[i].x1 + 1;
-
-        float area0 = h0 * w0;
+    // get output data
+    const float *scores = context.session->scores();
+    const float *boxes = context.session->boxes();
+    context.output_bytes_copied = context.session->outputBytesCopied();
+    if (count > 1 && context.session->outputBatch() != count) {
+        if (!batch_folded.exchange(true)) {
+            std::cerr << "Model outputs are not batched, falling back to one image per run." << std::endl;
+        }
+        return -1;
+    }
 
-        for (int j = i + 1; j < box_num; j++) {
-            if (merged[j])
-                continue;
+    for (int i = 0; i < count; i++) {
+        context.bbox_collection.clear();
+        generateBBox(context, scores + i * anchors.size() * 2, boxes + i * anchors.size() * 4,
+                     context.image_sizes[i].width, context.image_sizes[i].height);
+        if (context.nms_engine.run(context.bbox_collection, face_lists[i], nms_type) != 0) {
+            return -1;
+        }
+    }
 
-            float inner_x0 = input[i].x1 > input[j].x1 ? input[i].x1 : input[j].x1;
-            float inner_y0 = input[i].y1 > input[j].y1 ? input[i].y1 : input[j].y1;
+    context.last_timing.post_ms = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+    return 0;
+}
 
-            float inner_x1 = input[i].x2 < input[j].x2 ? input[i].x2 : input[j].x2;
-            float inner_y1 = input[i].y2 < input[j].y2 ? input[i].y2 : input[j].y2;
+// Zeros when the model failed to load and there is no built-in context
+const DetectTiming &UltraFace::getLastTiming() const {
+    static const DetectTiming none = {0, 0, 0};
+    return default_context ? default_context->getLastTiming() : none;
+}
 
-            float inner_h = inner_y1 - inner_y0 + 1;
-            float inner_w = inner_x1 - inner_x0 + 1;
+size_t UltraFace::getLastOutputBytesCopied() const {
+    return default_context ? default_context->getLastOutputBytesCopied() : 0;
+}
 
-            if (inner_h <= 0 || inner_w <= 0)
-                continue;
+void UltraFace::setNmsType(int type) {
+    nms_type = type;
+}
 
-            float inner_area = inner_h * inner_w;
+void UltraFace::setBilinear(bool enable) {
+    bilinear = enable;
+}
 
-            float h1 = input[j].y2 - input[j].y1 + 1;
-            float w1 = input[j].x2 - input[j].x1 + 1;
+const char *UltraFace::backendName() const {
+    return backend ? backend->name() : "none";
+}
 
-            float area1 = h1 * w1;
+void UltraFace::generateBBox(UltraFaceContext &context, const float *scores, const float *boxes, int image_w,
+                             int image_h) const {
+    context.candidates.clear();
+    decoder.scan(scores, score_threshold, context.candidates);
+    decoder.decode(scores, boxes, context.candidates, image_w, image_h, context.bbox_collection);
+}
 
-            float score;
+UltraFaceContext::UltraFaceContext(std::unique_ptr<BackendSession> session, const float mean[3], const float norm[3],
+                                   const NmsEngine &nms_engine)
+        : session(std::move(session)), preprocessor(mean, norm), nms_engine(nms_engine) {
+}
 
-            score = inner_area / (area0 + area1 - inner_area);
+const DetectTiming &UltraFaceContext::getLastTiming() const {
+    return last_timing;
+}
 
-            if (score > iou_threshold) {
-                merged[j] = 1;
-                buf.push_back(input[j]);
-            }
-        }
-        switch (type) {
-            case hard_nms: {
-                output.push_back(buf[0]);
-                break;
-            }
-            case blending_nms: {
-                float total = 0;
-                for (int i = 0; i < buf.size(); i++) {
-                    total += exp(buf[i].score);
-                }
-                FaceInfo rects;
-                memset(&rects, 0, sizeof(rects));
-                for (int i = 0; i < buf.size(); i++) {
-                    float rate = exp(buf[i].score) / total;
-                    rects.x1 += buf[i].x1 * rate;
-                    rects.y1 += buf[i].y1 * rate;
-                    rects.x2 += buf[i].x2 * rate;
-                    rects.y2 += buf[i].y2 * rate;
-                    rects.score += buf[i].score * rate;
-                }
-                output.push_back(rects);
-                break;
-            }
-            default: {
-                printf("wrong type of nms.");
-                exit(-1);
-            }
-        }
-    }
+size_t UltraFaceContext::getLastOutputBytesCopied() const {
+    return output_bytes_copied;
 }
@@ -0,0 +1,219 @@
+#include "V4l2FrameSource.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include <cstring>
+#include <iostream>
+
+static int systemOpen(const char* path, int flags) {
+    return ::open(path, flags);
+}
+
+static int systemIoctl(int fd, unsigned long request, void* arg) {
+    return ::ioctl(fd, request, arg);
+}
+
+static int systemPoll(int fd, int timeout_ms) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return ::poll(&pfd, 1, timeout_ms);
+}
+
+const V4l2DeviceOps& V4l2DeviceOps::system() {
+    static const V4l2DeviceOps ops = {systemOpen, ::close, systemIoctl, ::mmap, ::munmap, systemPoll};
+    return ops;
+}
+
+V4l2FrameSource::V4l2FrameSource(const std::string& device, int width, int height, int fps, int buffer_count,
+                                 const V4l2DeviceOps& ops)
+    : device(device), width(width), height(height), stride(0), fps(fps), buffer_count(buffer_count), ops(ops),
+      fd(-1), encoding(FRAME_ENCODING_JPEG), streaming(false) {}
+
+V4l2FrameSource::~V4l2FrameSource() {
+    closeDevice();
+}
+
+FrameEncoding V4l2FrameSource::getEncoding() const {
+    return encoding;
+}
+
+bool V4l2FrameSource::run(const std::atomic<bool>& running, const FrameCallback& callback) {
+    if (!openDevice() || !setFormat() || !startStreaming()) {
+        closeDevice();
+        return false;
+    }
+
+    bool ok = true;
+    while (running) {
+        int ready = ops.poll(fd, 200);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "poll() on " << device << " failed: " << strerror(errno) << std::endl;
+            ok = false;
+            break;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(VIDIOC_DQBUF, &buf) < 0) {
+            if (errno == EAGAIN) {
+                continue;
+            }
+            std::cerr << "VIDIOC_DQBUF failed: " << strerror(errno) << std::endl;
+            ok = false;
+            break;
+        }
+
+        // A raw frame shorter than a full image was cut off by the driver; JPEGs vary in size
+        size_t min_size = encoding == FRAME_ENCODING_YUYV ? (size_t) stride * height : 1;
+        if (buf.index < buffers.size() && buf.bytesused >= min_size && !(buf.flags & V4L2_BUF_FLAG_ERROR)) {
+            CapturedFrame frame = {(const unsigned char*) buffers[buf.index].start, buf.bytesused, encoding,
+                                   width, height, stride, 0};
+            callback(frame);
+        }
+
+        // Hand the buffer straight back so the driver never runs dry
+        if (xioctl(VIDIOC_QBUF, &buf) < 0) {
+            std::cerr << "VIDIOC_QBUF failed: " << strerror(errno) << std::endl;
+            ok = false;
+            break;
+        }
+    }
+
+    closeDevice();
+    return ok;
+}
+
+bool V4l2FrameSource::openDevice() {
+    fd = ops.open(device.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << device << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (xioctl(VIDIOC_QUERYCAP, &cap) < 0) {
+        std::cerr << device << " is not a V4L2 device." << std::endl;
+        return false;
+    }
+    unsigned int caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+        std::cerr << device << " does not support streaming video capture." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool V4l2FrameSource::setFormat() {
+    const unsigned int pixel_formats[] = {V4L2_PIX_FMT_MJPEG, V4L2_PIX_FMT_YUYV};
+    for (unsigned int pixel_format : pixel_formats) {
+        struct v4l2_format fmt;
+        memset(&fmt, 0, sizeof(fmt));
+        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        fmt.fmt.pix.width = width;
+        fmt.fmt.pix.height = height;
+        fmt.fmt.pix.pixelformat = pixel_format;
+        fmt.fmt.pix.field = V4L2_FIELD_NONE;
+        if (xioctl(VIDIOC_S_FMT, &fmt) < 0 || fmt.fmt.pix.pixelformat != pixel_format) {
+            continue;
+        }
+
+        // The driver may round the size to one it supports
+        if ((int) fmt.fmt.pix.width != width || (int) fmt.fmt.pix.height != height) {
+            std::cerr << device << " does not support " << width << "x" << height << ", using "
+                      << fmt.fmt.pix.width << "x" << fmt.fmt.pix.height << " instead." << std::endl;
+        }
+        width = fmt.fmt.pix.width;
+        height = fmt.fmt.pix.height;
+        stride = fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline : width * 2;
+        encoding = pixel_format == V4L2_PIX_FMT_MJPEG ? FRAME_ENCODING_JPEG : FRAME_ENCODING_YUYV;
+        std::cout << "Capturing " << width << "x" << height << (encoding == FRAME_ENCODING_JPEG ? " MJPEG" : " YUYV")
+                  << " from " << device << std::endl;
+
+        struct v4l2_streamparm parm;
+        memset(&parm, 0, sizeof(parm));
+        parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        parm.parm.capture.timeperframe.numerator = 1;
+        parm.parm.capture.timeperframe.denominator = fps;
+        xioctl(VIDIOC_S_PARM, &parm);  // Best effort, not every driver lets us pick the rate
+        return true;
+    }
+
+    std::cerr << device << " supports neither MJPEG nor YUYV capture." << std::endl;
+    return false;
+}
+
+bool V4l2FrameSource::startStreaming() {
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = buffer_count;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+        std::cerr << device << " could not allocate mmap buffers." << std::endl;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < req.count; i++) {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(VIDIOC_QUERYBUF, &buf) < 0) {
+            std::cerr << "VIDIOC_QUERYBUF failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        void* start = ops.mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+        if (start == MAP_FAILED) {
+            std::cerr << "mmap of capture buffer failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        buffers.push_back({start, buf.length});
+        if (xioctl(VIDIOC_QBUF, &buf) < 0) {
+            std::cerr << "VIDIOC_QBUF failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(VIDIOC_STREAMON, &type) < 0) {
+        std::cerr << "VIDIOC_STREAMON failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    streaming = true;
+    return true;
+}
+
+void V4l2FrameSource::closeDevice() {
+    if (streaming) {
+        int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(VIDIOC_STREAMOFF, &type);
+        streaming = false;
+    }
+    for (auto &buffer : buffers) {
+        ops.munmap(buffer.start, buffer.length);
+    }
+    buffers.clear();
+    if (fd >= 0) {
+        ops.close(fd);
+        fd = -1;
+    }
+}
+
+int V4l2FrameSource::xioctl(unsigned long request, void* arg) {
+    int r;
+    do {
+        r = ops.ioctl(fd, request, arg);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
@@ -3,24 +3,39 @@
 #include <atomic>
 #include <cstring>
 #include <fcntl.h>
-#include <sys/mman.h>
 #include <unistd.h>
 #include <chrono>
 #include <termios.h>
 #include <future>
 #include <opencv2/opencv.hpp>
-#include <curl/curl.h>
 #include <semaphore.h>
 #include <vector>
 #include <drogon/drogon.h>
 #include "UltraFace.hpp"
 #include "MotorController.hpp"
+#include "FrameConverter.hpp"
+#include "DecodePool.hpp"
+#include "HttpFrameSource.hpp"
+#include "V4l2FrameSource.hpp"
+#include "FrameRing.hpp"
+#include "FrameScheduler.hpp"
+#include "MotionGate.hpp"
+#include "DetectionPipeline.hpp"
+#include "MultiScaleDetector.hpp"
+#include "RoiDetector.hpp"
+#include "TiledDetector.hpp"
+#include "FaceTracker.hpp"
 
 std::atomic<bool> running(true);
-std::atomic<bool> newFrameForFaceDetectThread(false);
 std::atomic<bool> newDataAvailable(false);
 std::atomic<bool> faceDetectRunning(false);
 std::atomic<int> motorControlMode(0); // 0: 休眠, 1: 自动追踪, 2: 手动控制
+std::atomic<size_t> camFramesCaptured(0);
+std::atomic<size_t> camBytesCopied(0);          // Bytes memcpy'd between the source and the shared-memory frame
+std::atomic<size_t> camLastFrameBytesCopied(0);
+std::atomic<size_t> detectFrames(0);
+std::atomic<size_t> detectOutputBytesCopied(0);  // Bytes copied out of the inference outputs
+std::atomic<size_t> detectLastOutputBytesCopied(0);
 std::atomic<bool> upButtonPressed(false);
 std::atomic<bool> downButtonPressed(false);
 std::atomic<bool> leftButtonPressed(false);
@@ -32,12 +47,31 @@ MotorController yController = MotorController::selectMotor(true);
 sem_t* sem_newFrame;
 sem_t* sem_processedFrame;
 float* detectedBox;
-int cam_shm_fd;
 float faceLocationX = 0.0;
 float faceLocationY = 0.0;
-void* cam_shm_base;
+FrameRing camFrames;
+FrameScheduler camScheduler;
+MotionGate motionGate;
 int xStep = 0;
 int yStep = 0;
+std::string camUrl = "http://localhost:8080/";  // mjpg-streamer, or tools/fake_camera
+std::unique_ptr<FrameSource> camSource;
+HttpFrameSource* httpCamSource = nullptr;  // Set when camSource is the mjpg-streamer source
+int camFrameWidth = 320;  // --frame-size, what frames are decoded to and detected on
+int camFrameHeight = 240;
+std::unique_ptr<FrameConverter> camConverter;
+std::unique_ptr<DecodePool> camDecodePool;  // Only when --decode-workers is given; otherwise frames decode inline
+int faceNmsType = blending_nms;
+bool faceDetectPipelined = false;  // --pipeline
+std::string faceModelPath = "/home/code/main/model/version-slim/slim-320-quant-ADMM-50.mnn";
+std::string faceBackend;  // mnn or onnx, empty picks it from the model extension
+std::vector<cv::Size> faceInputSizes;  // --input-sizes, more than one picks a size per frame
+int faceRoiInterval = 0;  // --roi-tracking, frames between full scans while a face is tracked; 0 is off
+bool faceTiled = false;  // --tiles, input-sized tiles over high --frame-size frames
+float faceTileOverlap = 0.2;  // --tile-overlap
+int faceTileSessions = 1;  // --tile-sessions, more than one runs tiles on a session pool instead of one batch
+int faceTrackInterval = 0;  // --track, frames followed by the template tracker between detections; 0 is off
+std::atomic<size_t> trackFrames(0);
 
 class PIDController {
 public:
@@ -55,11 +89,6 @@ public:
     }
 };
 
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
-    return size * nmemb;
-}
-
 void initSemaphores() {
     sem_unlink("sem_newFrame");
     sem_unlink("sem_processedFrame");
@@ -79,15 +108,13 @@ void cleanupSemaphores() {
 }
 
 void initSharedMemory() {
-    cam_shm_fd = shm_open("/cam_frame", O_CREAT | O_RDWR, 0666);
-    ftruncate(cam_shm_fd, 320 * 240 * 3);
-    cam_shm_base = mmap(NULL, 320 * 240 * 3, PROT_READ | PROT_WRITE, MAP_SHARED, cam_shm_fd, 0);
+    if (!camFrames.create("/cam_frame", camFrameWidth, camFrameHeight)) {
+        exit(EXIT_FAILURE);
+    }
 }
 
 void cleanupSharedMemory() {
-    munmap(cam_shm_base, 320 * 240 * 3);
-    close(cam_shm_fd);
-    shm_unlink("/cam_frame");
+    camFrames.destroy();
 }
 
 void resetMotor(MotorController& xController, MotorController& yController, int& xStep, int& yStep) {
@@ -108,59 +135,192 @@ void resetMotor(MotorController& xController, MotorController& yController, int&
     yStep = 0;
 }
 
-void getCamFrame() {
-    CURL* curl = curl_easy_init();
-    curl_easy_setopt(curl, CURLOPT_URL, "http://localhost:8080/?action=snapshot");
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    std::string readBuffer;
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+void publishCamFrame(const CapturedFrame& captured) {
+    int64_t timestamp = FrameRing::now();
+    // Frames the detector could not get to in time are not even decoded
+    if (!camScheduler.shouldCapture(timestamp)) {
+        return;
+    }
+    if (camDecodePool) {
+        camDecodePool->submit(captured, timestamp);
+        return;
+    }
+
+    cv::Mat frame(camFrameHeight, camFrameWidth, CV_8UC3, camFrames.beginWrite());
+    PixelFormat format;
+    if (camConverter->convert(captured, frame, format)) {
+        camFrames.commitWrite(frame.cols, frame.rows, format, timestamp);
+        camFramesCaptured++;
+        camBytesCopied += captured.bytes_copied;
+        camLastFrameBytesCopied = captured.bytes_copied;
+    } else {
+        std::cerr << "Failed to decode the image." << std::endl;
+    }
+}
+
+// Decode workers finish into their own buffers, so publishing costs one frame copy into the ring
+void publishDecodedFrame(const cv::Mat& decoded, PixelFormat format, int64_t timestamp, size_t bytes_copied) {
+    size_t frame_bytes = decoded.total() * decoded.elemSize();
+    memcpy(camFrames.beginWrite(), decoded.data, frame_bytes);
+    camFrames.commitWrite(decoded.cols, decoded.rows, format, timestamp);
+    camFramesCaptured++;
+    camBytesCopied += bytes_copied + frame_bytes;
+    camLastFrameBytesCopied = bytes_copied + frame_bytes;
+}
 
+void getCamFrame() {
     while (running) {
-        readBuffer.clear();
-        CURLcode res = curl_easy_perform(curl);
-        if (res == CURLE_OK) {
-            std::vector<uchar> data(readBuffer.begin(), readBuffer.end());
-            cv::Mat img = cv::imdecode(data, cv::IMREAD_COLOR);
-            if (!img.empty()) {
-                cv::resize(img, img, cv::Size(320, 240), 0, 0, cv::INTER_NEAREST);
-                memcpy(cam_shm_base, img.data, 320 * 240 * 3);
-                newFrameForFaceDetectThread = true;
-            } else {
-                std::cerr << "Failed to decode the image." << std::endl;
-            }
-        } else {
-            std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
+        if (!camSource->run(running, publishCamFrame) && running) {
+            std::cerr << "Camera source failed, retrying." << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+}
+
+void updateFaceLocation(const std::vector<FaceInfo>& face_info) {
+    float max_width = 0;
+    FaceInfo largest_face;
+    for (auto &face : face_info) {
+        float width = face.x2 - face.x1;
+        if (width > max_width) {
+            max_width = width;
+            largest_face = face;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
 
-    curl_easy_cleanup(curl);
+    if (max_width > 0) {
+        faceLocationX = (largest_face.x1 + largest_face.x2) / (2.0 * camFrameWidth);
+        faceLocationY = (largest_face.y1 + largest_face.y2) / (2.0 * camFrameHeight);
+        newDataAvailable = true;
+    }
+}
+
+// Preprocess, inference and NMS on their own threads, each working on a different frame. Returns false, having
+// run nothing, when the pipeline's sessions could not be created.
+bool runDetectionPipeline(UltraFace& ultraface) {
+    int64_t last_result = 0;
+    int64_t last_result_cpu = 0;
+    DetectionPipeline pipeline(ultraface,
+        [](cv::Mat& frame, PixelFormat& format, int64_t& timestamp_us) {
+            const FrameSlot* slot = camFrames.acquireLatest();
+            if (!slot || !camScheduler.admit(slot->header->timestamp_us, FrameRing::now())) {
+                return false;
+            }
+            frame = cv::Mat(slot->header->height, slot->header->width, CV_8UC3, (void*)slot->data);
+            format = (PixelFormat)slot->header->format;
+            timestamp_us = slot->header->timestamp_us;
+            return motionGate.shouldDetect(frame, format, timestamp_us);
+        },
+        [&last_result, &last_result_cpu](int64_t timestamp_us, const std::vector<FaceInfo>& face_info,
+                                         const DetectTiming& timing) {
+            // With the stages overlapped, a frame can be taken in every time the slowest stage frees up
+            float stage_ms = std::max(timing.pre_ms, std::max(timing.infer_ms, timing.post_ms));
+            camScheduler.recordDetectLatency((int64_t) (stage_ms * 1000));
+
+            // Frames overlap, so each result is charged the process CPU time since the one before. That is
+            // only one frame's worth when they came back to back; after an idle gap the delta would bill the
+            // whole static scene, so it just restarts the measurement.
+            int64_t now = FrameRing::now();
+            int64_t cpu = MotionGate::processCpuTimeUs();
+            if (last_result && now - last_result <= now - timestamp_us) {
+                motionGate.recordDetectCpuTime(cpu - last_result_cpu);
+            }
+            last_result = now;
+            last_result_cpu = cpu;
+            detectFrames++;
+            updateFaceLocation(face_info);
+        });
+    if (!pipeline.start()) {
+        return false;
+    }
+    while (faceDetectRunning) {
+        usleep(10000);
+    }
+    pipeline.stop();
+    return true;
 }
 
 void faceDetectionTask() {
-    UltraFace ultraface("/home/code/main/model/version-slim/slim-320-quant-ADMM-50.mnn", 320, 240, 4, 0.65);
+    std::unique_ptr<UltraFace> ultraface;
+    std::unique_ptr<MultiScaleDetector> multiscale;
+    std::unique_ptr<RoiDetector> roi;
+    std::unique_ptr<TiledDetector> tiled;
+    if (faceTiled) {
+        cv::Size input = faceInputSizes.empty() ? cv::Size(320, 240) : faceInputSizes[0];
+        tiled.reset(new TiledDetector(faceModelPath, input, faceTileOverlap, faceTileSessions, 4, 0.65,
+                                      faceBackend));
+        tiled->setNmsType(faceNmsType);
+    } else if (faceRoiInterval > 0) {
+        cv::Size input = faceInputSizes.empty() ? cv::Size(320, 240) : faceInputSizes[0];
+        roi.reset(new RoiDetector(faceModelPath, input, cv::Size(160, 120), faceRoiInterval, 4, 0.65, faceBackend));
+        roi->setNmsType(faceNmsType);
+    } else if (faceInputSizes.size() > 1) {
+        multiscale.reset(new MultiScaleDetector(faceModelPath, faceInputSizes, cv::Size(320, 240), 4, 0.65,
+                                                faceBackend));
+        multiscale->setNmsType(faceNmsType);
+    } else {
+        cv::Size input = faceInputSizes.empty() ? cv::Size(320, 240) : faceInputSizes[0];
+        ultraface.reset(new UltraFace(faceModelPath, input.width, input.height, 4, 0.65, 0.3, -1, faceBackend));
+        ultraface->setNmsType(faceNmsType);
+        if (faceDetectPipelined) {
+            if (runDetectionPipeline(*ultraface)) {
+                return;
+            }
+            std::cerr << "Falling back to serial detection." << std::endl;
+        }
+    }
+    std::unique_ptr<FaceTracker> tracker;
+    if (faceTrackInterval > 0) {
+        tracker.reset(new FaceTracker(faceTrackInterval));
+    }
     while (faceDetectRunning) {
-        if (newFrameForFaceDetectThread) {
-            newFrameForFaceDetectThread = false;
-            cv::Mat frame(240, 320, CV_8UC3, cam_shm_base);
+        const FrameSlot* slot = camFrames.acquireLatest();
+        if (slot) {
+            int64_t start = FrameRing::now();
+            if (!camScheduler.admit(slot->header->timestamp_us, start)) {
+                continue;
+            }
+            cv::Mat frame(slot->header->height, slot->header->width, CV_8UC3, (void*)slot->data);
+            PixelFormat format = (PixelFormat)slot->header->format;
+            // Between detections the tracker moves the face on every frame. Its latency feeds the
+            // scheduler too, so capture speeds up to what tracking plus the occasional detection sustains.
+            FaceInfo tracked;
+            if (tracker && !tracker->needsDetection() && tracker->update(frame, format, tracked)) {
+                trackFrames++;
+                camScheduler.recordDetectLatency(FrameRing::now() - start);
+                updateFaceLocation({tracked});
+                continue;
+            }
+            // A static scene keeps the last result, which the motors have already acted on
+            if (!motionGate.shouldDetect(frame, format, slot->header->timestamp_us)) {
+                continue;
+            }
             std::vector<FaceInfo> face_info;
-            ultraface.detect(frame, face_info);
-
-            float max_width = 0;
-            FaceInfo largest_face;
-            for (auto &face : face_info) {
-                float width = face.x2 - face.x1;
-                if (width > max_width) {
-                    max_width = width;
-                    largest_face = face;
-                }
+            int64_t cpu_start = MotionGate::processCpuTimeUs();
+            size_t bytes_copied;
+            if (tiled) {
+                tiled->detect(frame, face_info, format);
+                bytes_copied = tiled->getLastOutputBytesCopied();
+            } else if (roi) {
+                roi->detect(frame, face_info, format);
+                bytes_copied = roi->getLastOutputBytesCopied();
+            } else if (multiscale) {
+                multiscale->detect(frame, face_info, format);
+                bytes_copied = multiscale->getLastOutputBytesCopied();
+            } else {
+                ultraface->detect(frame, face_info, format);
+                bytes_copied = ultraface->getLastOutputBytesCopied();
             }
+            motionGate.recordDetectCpuTime(MotionGate::processCpuTimeUs() - cpu_start);
+            detectFrames++;
+            detectOutputBytesCopied += bytes_copied;
+            detectLastOutputBytesCopied = bytes_copied;
+            camScheduler.recordDetectLatency(FrameRing::now() - start);
 
-            if (max_width > 0) {
-                faceLocationX = (largest_face.x1 + largest_face.x2) / 640.0;
-                faceLocationY = (largest_face.y1 + largest_face.y2) / 480.0;
-                newDataAvailable = true;
+            if (tracker) {
+                tracker->sync(frame, format, face_info);
             }
+            updateFaceLocation(face_info);
         } else {
             usleep(10000);
         }
@@ -212,12 +372,19 @@ void setMotorControlMode(int mode) {
     motorControlMode = mode;
 }
 
+void setCamCaptureMode(int mode) {
+    if (httpCamSource) {
+        httpCamSource->setMode(mode);
+    }
+}
+
 void startDrogon() {
     drogon::app().addListener("0.0.0.0", 8081);
     drogon::app().registerHandler("/drogon/start_face_detect", [](const drogon::HttpRequestPtr& req,
                                                            std::function<void (const drogon::HttpResponsePtr &)> &&callback) {
         if (!faceDetectRunning) {
             faceDetectRunning = true;
+            camScheduler.reset();
             faceDetectThread = std::thread(faceDetectionTask);
             auto resp = drogon::HttpResponse::newHttpResponse();
             resp->setBody("Face detection started.");
@@ -255,6 +422,72 @@ void startDrogon() {
             callback(resp);
         }
     });
+    drogon::app().registerHandler("/drogon/set_capture_mode", [](const drogon::HttpRequestPtr& req,
+                                                                 std::function<void (const drogon::HttpResponsePtr &)> &&callback) {
+        auto json = req->getJsonObject();
+        if (json) {
+            int mode = (*json)["mode"].asInt();
+            setCamCaptureMode(mode);
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setBody("Capture mode set.");
+            callback(resp);
+        }
+    });
+    drogon::app().registerHandler("/drogon/capture_stats", [](const drogon::HttpRequestPtr& req,
+                                                              std::function<void (const drogon::HttpResponsePtr &)> &&callback) {
+        Json::Value stats;
+        size_t frames = camFramesCaptured;
+        stats["frames"] = (Json::UInt64)frames;
+        stats["bytes_copied_last_frame"] = (Json::UInt64)camLastFrameBytesCopied.load();
+        stats["bytes_copied_per_frame"] = frames ? (double)camBytesCopied / frames : 0.0;
+
+        FrameScheduler::Stats schedule = camScheduler.getStats();
+        stats["deadline_ms"] = camScheduler.getDeadlineMs();
+        stats["detect_latency_ms"] = schedule.detect_latency_ms;
+        stats["capture_interval_ms"] = schedule.capture_interval_ms;
+        stats["frames_admitted"] = (Json::UInt64)schedule.frames_admitted;
+        stats["frames_dropped"] = (Json::UInt64)schedule.frames_dropped;
+        stats["frames_throttled"] = (Json::UInt64)schedule.frames_throttled;
+        Json::Value histogram;
+        for (int i = 0; i < FRAME_AGE_BUCKETS; i++) {
+            std::string bucket = i < FRAME_AGE_BUCKETS - 1
+                    ? "<" + std::to_string(FrameScheduler::age_bucket_limits_ms[i]) + "ms"
+                    : ">=" + std::to_string(FrameScheduler::age_bucket_limits_ms[i - 1]) + "ms";
+            histogram[bucket] = (Json::UInt64)schedule.age_histogram[i];
+        }
+        stats["frame_age_histogram"] = histogram;
+
+        size_t detected = detectFrames;
+        Json::Value detector;
+        detector["frames"] = (Json::UInt64)detected;
+        detector["tracked_frames"] = (Json::UInt64)trackFrames.load();  // Served by the tracker in between
+        detector["output_bytes_copied_last_frame"] = (Json::UInt64)detectLastOutputBytesCopied.load();
+        detector["output_bytes_copied_per_frame"] = detected ? (double)detectOutputBytesCopied / detected : 0.0;
+        stats["detector"] = detector;
+
+        MotionGate::Stats motion = motionGate.getStats();
+        Json::Value gate;
+        gate["frames"] = (Json::UInt64)motion.frames;
+        gate["skipped"] = (Json::UInt64)motion.skipped;
+        gate["skip_ratio"] = motion.skip_ratio;
+        gate["gate_cpu_ms_per_frame"] = motion.gate_cpu_ms;
+        gate["detect_cpu_ms_per_run"] = motion.detect_cpu_ms;
+        gate["cpu_ms_saved"] = motion.saved_cpu_ms;
+        stats["motion_gate"] = gate;
+
+        if (camDecodePool) {
+            DecodePool::Stats pool = camDecodePool->getStats();
+            Json::Value decode;
+            decode["workers"] = camDecodePool->getWorkerCount();
+            decode["submitted"] = (Json::UInt64)pool.submitted;
+            decode["published"] = (Json::UInt64)pool.published;
+            decode["dropped_waiting"] = (Json::UInt64)pool.dropped_waiting;
+            decode["dropped_late"] = (Json::UInt64)pool.dropped_late;
+            decode["failed"] = (Json::UInt64)pool.failed;
+            stats["decode_pool"] = decode;
+        }
+        callback(drogon::HttpResponse::newHttpJsonResponse(stats));
+    });
     drogon::app().registerHandler("/drogon/set_button_state", [](const drogon::HttpRequestPtr& req,
                                                             std::function<void (const drogon::HttpResponsePtr &)> &&callback) {
         auto json = req->getJsonObject();
@@ -271,7 +504,113 @@ void startDrogon() {
     drogon::app().run();
 }
 
-int main() {
+// Every option but --tiles and --pipeline
+const char* const valueOptions[] = {
+    "--camera-url", "--capture-mode", "--device", "--deadline-ms", "--motion-threshold", "--motion-max-skip-ms",
+    "--nms", "--model", "--backend", "--frame-size", "--capture-size", "--input-sizes", "--roi-tracking",
+    "--tile-overlap", "--tile-sessions", "--track", "--decode-workers"};
+
+bool takesValue(const std::string& arg) {
+    for (const char* option : valueOptions) {
+        if (arg == option) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void printUsage() {
+    std::cerr << "Usage: ./main [--camera-url URL] [--capture-mode stream|snapshot] [--device /dev/videoN]"
+              << " [--capture-size WxH] [--frame-size WxH] [--deadline-ms N] [--motion-threshold X]"
+              << " [--motion-max-skip-ms N] [--nms hard|blending|fast|soft] [--model PATH] [--backend mnn|onnx]"
+              << " [--input-sizes WxH,...] [--roi-tracking N] [--tiles] [--tile-overlap X] [--tile-sessions N]"
+              << " [--track N] [--pipeline] [--decode-workers N]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string camDevice;
+    int captureWidth = 0;  // --capture-size, V4L2 only; defaults to --frame-size
+    int captureHeight = 0;
+    int httpCaptureMode = HTTP_CAPTURE_STREAM;
+    int decodeWorkers = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc && takesValue(arg)) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        if (arg == "--camera-url") {
+            camUrl = argv[++i];
+            camUrl = camUrl.substr(0, camUrl.find('?'));
+        } else if (arg == "--capture-mode") {
+            httpCaptureMode = std::string(argv[++i]) == "snapshot" ? HTTP_CAPTURE_SNAPSHOT : HTTP_CAPTURE_STREAM;
+        } else if (arg == "--device") {
+            camDevice = argv[++i];  // e.g. /dev/video0, bypasses mjpg-streamer
+        } else if (arg == "--deadline-ms") {
+            camScheduler.setDeadlineMs(atoi(argv[++i]));
+        } else if (arg == "--motion-threshold") {
+            motionGate.setThreshold(atof(argv[++i]));  // 0 runs the detector on every frame
+        } else if (arg == "--motion-max-skip-ms") {
+            motionGate.setMaxSkipMs(atoi(argv[++i]));
+        } else if (arg == "--nms") {
+            int type = NmsEngine::typeFromName(argv[++i]);
+            if (type < 0) {
+                std::cerr << "Unknown --nms mode, expected hard, blending, fast or soft." << std::endl;
+                return 1;
+            }
+            faceNmsType = type;
+        } else if (arg == "--model") {
+            faceModelPath = argv[++i];
+        } else if (arg == "--backend") {
+            faceBackend = argv[++i];
+        } else if (arg == "--frame-size") {
+            if (sscanf(argv[++i], "%dx%d", &camFrameWidth, &camFrameHeight) != 2) {
+                std::cerr << "Expected --frame-size WIDTHxHEIGHT." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--capture-size") {
+            if (sscanf(argv[++i], "%dx%d", &captureWidth, &captureHeight) != 2) {
+                std::cerr << "Expected --capture-size WIDTHxHEIGHT." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--input-sizes") {
+            faceInputSizes = MultiScaleDetector::parseSizes(argv[++i]);  // e.g. 160x120,320x240,640x480
+        } else if (arg == "--roi-tracking") {
+            faceRoiInterval = atoi(argv[++i]);
+        } else if (arg == "--tiles") {
+            faceTiled = true;  // Tile count follows from --frame-size and --tile-overlap
+        } else if (arg == "--tile-overlap") {
+            faceTileOverlap = atof(argv[++i]);
+        } else if (arg == "--tile-sessions") {
+            faceTileSessions = atoi(argv[++i]);
+        } else if (arg == "--track") {
+            faceTrackInterval = atoi(argv[++i]);
+        } else if (arg == "--pipeline") {
+            faceDetectPipelined = true;
+        } else if (arg == "--decode-workers") {
+            decodeWorkers = atoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+    camConverter.reset(new FrameConverter(JPEG_DECODER_SCALED, camFrameWidth, camFrameHeight));
+    if (decodeWorkers > 0) {
+        camDecodePool.reset(new DecodePool(decodeWorkers, JPEG_DECODER_SCALED, camFrameWidth, camFrameHeight,
+                                           publishDecodedFrame));
+    }
+    if (!camDevice.empty()) {
+        // The driver may settle on a nearby size; V4l2FrameSource logs the one it got
+        camSource.reset(new V4l2FrameSource(camDevice, captureWidth > 0 ? captureWidth : camFrameWidth,
+                                            captureHeight > 0 ? captureHeight : camFrameHeight));
+    } else {
+        httpCamSource = new HttpFrameSource(camUrl + "?action=snapshot", camUrl + "?action=stream", httpCaptureMode);
+        camSource.reset(httpCamSource);
+    }
+    camSource->setScheduler(&camScheduler);
+
     wiringPiSetup();
     initSemaphores();
     initSharedMemory();
@@ -293,6 +632,7 @@ int main() {
     }
 
     camFrameThread.join();
+    camDecodePool.reset();
     faceDetectThread.join();
     motorControlThread.join();
     drogonThread.join();
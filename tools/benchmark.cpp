@@ -0,0 +1,1178 @@
+// Offline benchmarks for the capture and detection pipeline, no camera or motors needed.
+// Usage: ./benchmark <suite> [args...]
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <chrono>
+#include <iostream>
+#include <unistd.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "Interpreter.hpp"
+#include "ImageProcess.hpp"
+#include "JpegDecoder.hpp"
+#include "DecodePool.hpp"
+#include "UltraFace.hpp"
+#include "FusedPreprocessor.hpp"
+#include "BoxDecoder.hpp"
+#include "NmsEngine.hpp"
+#include "DetectorPool.hpp"
+#include "DetectionPipeline.hpp"
+#include "FrameRing.hpp"
+#include "MultiScaleDetector.hpp"
+#include "RoiDetector.hpp"
+#include "TiledDetector.hpp"
+#include "FaceTracker.hpp"
+
+using namespace std;
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Builds a camera-like test JPEG: the given image scaled to size, or a synthetic pattern
+static vector<uchar> makeJpeg(const string &source_path, cv::Size size) {
+    cv::Mat image;
+    if (!source_path.empty()) {
+        cv::Mat source = cv::imread(source_path);
+        if (!source.empty()) {
+            cv::resize(source, image, size, 0, 0, cv::INTER_AREA);
+        }
+    }
+    if (image.empty()) {
+        image = cv::Mat(size, CV_8UC3);
+        for (int y = 0; y < size.height; y++) {
+            uchar *row = image.ptr(y);
+            for (int x = 0; x < size.width; x++) {
+                row[x * 3] = (uchar) (x * 255 / size.width);
+                row[x * 3 + 1] = (uchar) (y * 255 / size.height);
+                row[x * 3 + 2] = (uchar) (((x / 16) ^ (y / 16)) & 1 ? 200 : 40);
+            }
+        }
+    }
+    vector<uchar> jpeg;
+    cv::imencode(".jpg", image, jpeg, {cv::IMWRITE_JPEG_QUALITY, 80});
+    return jpeg;
+}
+
+// jpeg [image] [iterations]: imdecode+resize vs scaled IDCT decode, per camera resolution
+static int benchJpeg(int argc, char **argv) {
+    string source_path = argc > 0 ? argv[0] : "";
+    int iterations = argc > 1 ? stoi(argv[1]) : 200;
+    const cv::Size sizes[] = {cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080)};
+    const JpegDecoderBackend backends[] = {JPEG_DECODER_OPENCV, JPEG_DECODER_SCALED};
+    const char *names[] = {"opencv", "scaled"};
+
+    cv::Mat frame(240, 320, CV_8UC3);
+    for (auto size : sizes) {
+        vector<uchar> jpeg = makeJpeg(source_path, size);
+        for (auto backend : backends) {
+            auto decoder = JpegDecoder::create(backend, 320, 240);
+            decoder->decode(jpeg.data(), jpeg.size(), frame);  // warm-up, sizes the scratch buffers
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                decoder->decode(jpeg.data(), jpeg.size(), frame);
+            }
+            double ms = elapsedMs(start) / iterations;
+            cout << size.width << "x" << size.height << " " << names[backend] << ": " << ms << " ms/frame, "
+                 << 1000.0 / ms << " fps (" << jpeg.size() << " byte JPEG)" << endl;
+        }
+    }
+    return 0;
+}
+
+// decode-pool [image] [max_workers] [seconds]: published fps of the decode pool for 1..max_workers,
+// fed 1280x720 JPEGs as fast as submit() returns
+static int benchDecodePool(int argc, char **argv) {
+    string source_path = argc > 0 ? argv[0] : "";
+    int max_workers = argc > 1 ? stoi(argv[1]) : 4;
+    double seconds = argc > 2 ? stod(argv[2]) : 3.0;
+
+    vector<uchar> jpeg = makeJpeg(source_path, cv::Size(1280, 720));
+    CapturedFrame frame = {jpeg.data(), jpeg.size(), FRAME_ENCODING_JPEG, 0, 0, 0, 0};
+    for (int workers = 1; workers <= max_workers; workers++) {
+        atomic<uint64_t> published(0);
+        DecodePool pool(workers, JPEG_DECODER_SCALED, 320, 240,
+                        [&](const cv::Mat &, PixelFormat, int64_t, size_t) { published++; });
+        auto start = chrono::steady_clock::now();
+        while (elapsedMs(start) < seconds * 1000) {
+            pool.submit(frame, 0);
+            this_thread::sleep_for(chrono::microseconds(500));  // ~2000 fps offered, far above any worker count
+        }
+        double elapsed = elapsedMs(start) / 1000;
+        DecodePool::Stats stats = pool.getStats();
+        cout << workers << " worker(s): " << published / elapsed << " fps published, "
+             << stats.dropped_waiting << " dropped waiting, " << stats.dropped_late << " dropped late" << endl;
+    }
+    return 0;
+}
+
+static cv::Mat loadFrame(const string &image_path, cv::Size size) {
+    vector<uchar> jpeg = makeJpeg(image_path, size);
+    return cv::imdecode(jpeg, cv::IMREAD_COLOR);
+}
+
+static void printTiming(const string &label, const DetectTiming &total, int iterations) {
+    cout << label << ": pre " << total.pre_ms / iterations << " ms, infer " << total.infer_ms / iterations
+         << " ms, post " << total.post_ms / iterations << " ms" << endl;
+}
+
+// detect <model> [image] [iterations]: UltraFace per-frame latency breakdown, next to the previous
+// detect() flow that resized the session and rebuilt ImageProcess on every frame
+static int benchDetect(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "detect needs a model path" << endl;
+        return 1;
+    }
+    string model_path = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    int iterations = argc > 2 ? stoi(argv[2]) : 100;
+    cv::Mat frame = loadFrame(image_path, cv::Size(320, 240));
+
+    // Previous flow, rebuilt with the raw MNN API. Its post column only covers fetching the outputs.
+    {
+        shared_ptr<MNN::Interpreter> interpreter(MNN::Interpreter::createFromFile(model_path.c_str()));
+        MNN::ScheduleConfig config;
+        config.numThread = 4;
+        MNN::BackendConfig backendConfig;
+        backendConfig.precision = (MNN::BackendConfig::PrecisionMode) 2;
+        config.backendConfig = &backendConfig;
+        MNN::Session *session = interpreter->createSession(config);
+        MNN::Tensor *input = interpreter->getSessionInput(session, nullptr);
+        const float mean_vals[3] = {127, 127, 127};
+        const float norm_vals[3] = {1.0 / 128, 1.0 / 128, 1.0 / 128};
+
+        DetectTiming total = {0, 0, 0};
+        for (int i = 0; i < iterations; i++) {
+            auto start = chrono::steady_clock::now();
+            cv::Mat image;
+            cv::resize(frame, image, cv::Size(320, 240));
+            interpreter->resizeTensor(input, {1, 3, 240, 320});
+            interpreter->resizeSession(session);
+            shared_ptr<MNN::CV::ImageProcess> pretreat(
+                    MNN::CV::ImageProcess::create(MNN::CV::BGR, MNN::CV::RGB, mean_vals, 3, norm_vals, 3));
+            pretreat->convert(image.data, 320, 240, image.step[0], input);
+            total.pre_ms += elapsedMs(start);
+
+            start = chrono::steady_clock::now();
+            interpreter->runSession(session);
+            total.infer_ms += elapsedMs(start);
+
+            start = chrono::steady_clock::now();
+            MNN::Tensor *scores = interpreter->getSessionOutput(session, "scores");
+            MNN::Tensor *boxes = interpreter->getSessionOutput(session, "boxes");
+            MNN::Tensor scores_host(scores, scores->getDimensionType());
+            scores->copyToHostTensor(&scores_host);
+            MNN::Tensor boxes_host(boxes, boxes->getDimensionType());
+            boxes->copyToHostTensor(&boxes_host);
+            total.post_ms += elapsedMs(start);
+        }
+        interpreter->releaseSession(session);
+        printTiming("per-frame re-plan (before)", total, iterations);
+    }
+
+    auto construct_start = chrono::steady_clock::now();
+    UltraFace ultraface(model_path, 320, 240, 4, 0.65);
+    cout << "UltraFace constructor (incl. warm-up): " << elapsedMs(construct_start) << " ms" << endl;
+
+    DetectTiming total = {0, 0, 0};
+    vector<FaceInfo> faces;
+    for (int i = 0; i < iterations; i++) {
+        faces.clear();
+        ultraface.detect(frame, faces);
+        const DetectTiming &timing = ultraface.getLastTiming();
+        total.pre_ms += timing.pre_ms;
+        total.infer_ms += timing.infer_ms;
+        total.post_ms += timing.post_ms;
+    }
+    printTiming("UltraFace::detect", total, iterations);
+    cout << "UltraFace output bytes copied per frame: " << ultraface.getLastOutputBytesCopied() << endl;
+    return 0;
+}
+
+// preprocess [image] [iterations]: cv::resize + ImageProcess::convert vs the fused kernel, into NCHW and
+// NC4HW4 host tensors, for camera frames at and above the network input size
+static int benchPreprocess(int argc, char **argv) {
+    string image_path = argc > 0 ? argv[0] : "";
+    int iterations = argc > 1 ? stoi(argv[1]) : 500;
+    const float mean_vals[3] = {127, 127, 127};
+    const float norm_vals[3] = {1.0 / 128, 1.0 / 128, 1.0 / 128};
+    const cv::Size sizes[] = {cv::Size(320, 240), cv::Size(640, 480)};
+    const MNN::Tensor::DimensionType layouts[] = {MNN::Tensor::CAFFE, MNN::Tensor::CAFFE_C4};
+    const char *layout_names[] = {"NCHW", "NC4HW4"};
+
+    shared_ptr<MNN::CV::ImageProcess> pretreat(
+            MNN::CV::ImageProcess::create(MNN::CV::BGR, MNN::CV::RGB, mean_vals, 3, norm_vals, 3));
+    FusedPreprocessor fused(mean_vals, norm_vals);
+    cout << "fused kernel: " << FusedPreprocessor::kernelName() << endl;
+
+    for (auto size : sizes) {
+        cv::Mat frame = loadFrame(image_path, size);
+        for (int l = 0; l < 2; l++) {
+            unique_ptr<MNN::Tensor> input(MNN::Tensor::create<float>({1, 3, 240, 320}, nullptr, layouts[l]));
+
+            cv::Mat resized;
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                cv::resize(frame, resized, cv::Size(320, 240));
+                pretreat->convert(resized.data, 320, 240, resized.step[0], input.get());
+            }
+            double two_pass_ms = elapsedMs(start) / iterations;
+
+            // Compared as NCHW, whatever the layout of the input
+            MNN::Tensor host(input.get(), MNN::Tensor::CAFFE);
+            input->copyToHostTensor(&host);
+            vector<float> reference(host.host<float>(), host.host<float>() + host.elementSize());
+
+            // Bilinear is the default and matches cv::resize; nearest-neighbour is the cheaper option
+            for (int bilinear = 1; bilinear >= 0; bilinear--) {
+                fused.setBilinear(bilinear);
+                start = chrono::steady_clock::now();
+                for (int i = 0; i < iterations; i++) {
+                    fused.convert(frame.data, frame.cols, frame.rows, frame.step[0], PIXEL_FORMAT_BGR, input.get());
+                }
+                double fused_ms = elapsedMs(start) / iterations;
+
+                // Difference from the two-pass input, in 8-bit pixel levels
+                input->copyToHostTensor(&host);
+                const float *out = host.host<float>();
+                double max_diff = 0, sum_diff = 0;
+                for (size_t i = 0; i < reference.size(); i++) {
+                    double diff = fabs(out[i] - reference[i]) / norm_vals[0];
+                    max_diff = max(max_diff, diff);
+                    sum_diff += diff;
+                }
+                cout << size.width << "x" << size.height << " -> 320x240 " << layout_names[l] << ": two-pass "
+                     << two_pass_ms << " ms, fused " << (bilinear ? "bilinear " : "nearest ") << fused_ms << " ms ("
+                     << two_pass_ms / fused_ms << "x), input diff " << sum_diff / reference.size() << " avg, "
+                     << max_diff << " max" << endl;
+            }
+            fused.setBilinear(true);
+        }
+    }
+
+    // Whether the input differences change what the detector finds
+    if (argc > 2) {
+        UltraFace ultraface(argv[2], 320, 240, 4, 0.7);
+        for (auto size : sizes) {
+            cv::Mat frame = loadFrame(image_path, size);
+            cv::Mat resized;
+            cv::resize(frame, resized, cv::Size(320, 240));
+            vector<FaceInfo> reference, faces;
+            ultraface.detect(resized, reference);
+            float sx = frame.cols / 320.0f, sy = frame.rows / 240.0f;
+            for (FaceInfo &face : reference) {
+                face.x1 *= sx;
+                face.x2 *= sx;
+                face.y1 *= sy;
+                face.y2 *= sy;
+            }
+            for (int bilinear = 1; bilinear >= 0; bilinear--) {
+                faces.clear();
+                ultraface.setBilinear(bilinear);
+                ultraface.detect(frame, faces);
+                float shift = 0;
+                for (size_t i = 0; i < min(faces.size(), reference.size()); i++) {
+                    shift = max({shift, fabs(faces[i].x1 - reference[i].x1), fabs(faces[i].x2 - reference[i].x2),
+                                 fabs(faces[i].y1 - reference[i].y1), fabs(faces[i].y2 - reference[i].y2)});
+                }
+                cout << size.width << "x" << size.height << " " << (bilinear ? "bilinear" : "nearest") << ": "
+                     << faces.size() << " faces vs " << reference.size() << " from cv::resize, boxes within "
+                     << shift << " px" << endl;
+            }
+            ultraface.setBilinear(true);
+        }
+    }
+    return 0;
+}
+
+static bool writeFloats(const string &path, const MNN::Tensor *tensor) {
+    MNN::Tensor host(tensor, MNN::Tensor::CAFFE);
+    tensor->copyToHostTensor(&host);
+    ofstream out(path, ios::binary);
+    out.write(reinterpret_cast<const char *>(host.host<float>()), host.elementSize() * sizeof(float));
+    return out.good();
+}
+
+static vector<float> readFloats(const string &path) {
+    ifstream in(path, ios::binary | ios::ate);
+    vector<float> data(in.good() ? (size_t) in.tellg() / sizeof(float) : 0);
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(data.data()), data.size() * sizeof(float));
+    return data;
+}
+
+// record <model> <image> <prefix>: runs the model once and saves its raw outputs as <prefix>.scores
+// and <prefix>.boxes, inputs for the decode suite
+static int benchRecord(int argc, char **argv) {
+    if (argc < 3) {
+        cerr << "record needs a model, an image and an output prefix" << endl;
+        return 1;
+    }
+    string prefix = argv[2];
+    cv::Mat frame = loadFrame(argv[1], cv::Size(320, 240));
+    shared_ptr<MNN::Interpreter> interpreter(MNN::Interpreter::createFromFile(argv[0]));
+    MNN::ScheduleConfig config;
+    MNN::Session *session = interpreter->createSession(config);
+    MNN::Tensor *input = interpreter->getSessionInput(session, nullptr);
+    interpreter->resizeTensor(input, {1, 3, 240, 320});
+    interpreter->resizeSession(session);
+    const float mean_vals[3] = {127, 127, 127};
+    const float norm_vals[3] = {1.0 / 128, 1.0 / 128, 1.0 / 128};
+    FusedPreprocessor(mean_vals, norm_vals).convert(frame.data, frame.cols, frame.rows, frame.step[0],
+                                                    PIXEL_FORMAT_BGR, input);
+    interpreter->runSession(session);
+    bool ok = writeFloats(prefix + ".scores", interpreter->getSessionOutput(session, "scores")) &&
+              writeFloats(prefix + ".boxes", interpreter->getSessionOutput(session, "boxes"));
+    interpreter->releaseSession(session);
+    if (!ok) {
+        cerr << "Failed to write " << prefix << ".scores/.boxes" << endl;
+        return 1;
+    }
+    cout << "Saved " << prefix << ".scores and " << prefix << ".boxes" << endl;
+    return 0;
+}
+
+// The scalar decoder UltraFace used before BoxDecoder, kept as the accuracy and speed baseline
+static void referenceDecode(const AnchorTable &anchors, const float *scores, const float *boxes, float threshold,
+                            int image_w, int image_h, vector<FaceInfo> &faces) {
+#define clip(x, y) (x < 0 ? 0 : (x > y ? y : x))
+    for (int i = 0; i < anchors.size(); i++) {
+        if (scores[i * 2 + 1] > threshold) {
+            FaceInfo rects;
+            float x_center = boxes[i * 4] * 0.1f * anchors.w[i] + anchors.cx[i];
+            float y_center = boxes[i * 4 + 1] * 0.1f * anchors.h[i] + anchors.cy[i];
+            float w = exp(boxes[i * 4 + 2] * 0.2f) * anchors.w[i];
+            float h = exp(boxes[i * 4 + 3] * 0.2f) * anchors.h[i];
+            rects.x1 = clip(x_center - w / 2.0, 1) * image_w;
+            rects.y1 = clip(y_center - h / 2.0, 1) * image_h;
+            rects.x2 = clip(x_center + w / 2.0, 1) * image_w;
+            rects.y2 = clip(y_center + h / 2.0, 1) * image_h;
+            rects.score = clip(scores[i * 2 + 1], 1);
+            faces.push_back(rects);
+        }
+    }
+#undef clip
+}
+
+// decode <prefix> [threshold] [iterations]: scalar vs vectorized generateBBox over recorded outputs of a
+// 320x240 model, with the largest coordinate difference between the two in pixels of a 640x480 frame
+static int benchDecode(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "decode needs a recording prefix, see the record suite" << endl;
+        return 1;
+    }
+    string prefix = argv[0];
+    float threshold = argc > 1 ? stof(argv[1]) : 0.7f;
+    int iterations = argc > 2 ? stoi(argv[2]) : 2000;
+    vector<float> scores = readFloats(prefix + ".scores");
+    vector<float> boxes = readFloats(prefix + ".boxes");
+    AnchorTable anchors(320, 240);
+    if (scores.size() != (size_t) anchors.size() * 2 || boxes.size() != (size_t) anchors.size() * 4) {
+        cerr << "Recording does not match the " << anchors.size() << " anchors of a 320x240 model" << endl;
+        return 1;
+    }
+    BoxDecoder decoder(anchors, 0.1f, 0.2f);
+
+    vector<FaceInfo> reference;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        reference.clear();
+        referenceDecode(anchors, scores.data(), boxes.data(), threshold, 640, 480, reference);
+    }
+    double reference_us = elapsedMs(start) * 1000 / iterations;
+
+    vector<FaceInfo> faces;
+    vector<int> candidates;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        faces.clear();
+        candidates.clear();
+        decoder.scan(scores.data(), threshold, candidates);
+        decoder.decode(scores.data(), boxes.data(), candidates, 640, 480, faces);
+    }
+    double vector_us = elapsedMs(start) * 1000 / iterations;
+
+    if (faces.size() != reference.size()) {
+        cerr << "Candidate count differs: " << faces.size() << " vs " << reference.size() << endl;
+        return 1;
+    }
+    float max_diff = 0;
+    for (size_t i = 0; i < faces.size(); i++) {
+        max_diff = max(max_diff, fabs(faces[i].x1 - reference[i].x1));
+        max_diff = max(max_diff, fabs(faces[i].y1 - reference[i].y1));
+        max_diff = max(max_diff, fabs(faces[i].x2 - reference[i].x2));
+        max_diff = max(max_diff, fabs(faces[i].y2 - reference[i].y2));
+        max_diff = max(max_diff, fabs(faces[i].score - reference[i].score));
+    }
+    cout << faces.size() << " candidates, scan kernel " << BoxDecoder::kernelName() << ": scalar " << reference_us
+         << " us, vectorized " << vector_us << " us, max difference " << max_diff << endl;
+    return 0;
+}
+
+// The nms UltraFace used before NmsEngine: full sort and a vector per kept box
+static void referenceNms(vector<FaceInfo> input, vector<FaceInfo> &output, int type, float iou_threshold) {
+    sort(input.begin(), input.end(), [](const FaceInfo &a, const FaceInfo &b) { return a.score > b.score; });
+    int box_num = input.size();
+    vector<int> merged(box_num, 0);
+    for (int i = 0; i < box_num; i++) {
+        if (merged[i])
+            continue;
+        vector<FaceInfo> buf;
+        buf.push_back(input[i]);
+        merged[i] = 1;
+        float area0 = (input[i].y2 - input[i].y1 + 1) * (input[i].x2 - input[i].x1 + 1);
+        for (int j = i + 1; j < box_num; j++) {
+            if (merged[j])
+                continue;
+            float inner_w = min(input[i].x2, input[j].x2) - max(input[i].x1, input[j].x1) + 1;
+            float inner_h = min(input[i].y2, input[j].y2) - max(input[i].y1, input[j].y1) + 1;
+            if (inner_h <= 0 || inner_w <= 0)
+                continue;
+            float inner_area = inner_h * inner_w;
+            float area1 = (input[j].y2 - input[j].y1 + 1) * (input[j].x2 - input[j].x1 + 1);
+            if (inner_area / (area0 + area1 - inner_area) > iou_threshold) {
+                merged[j] = 1;
+                buf.push_back(input[j]);
+            }
+        }
+        if (type == hard_nms) {
+            output.push_back(buf[0]);
+            continue;
+        }
+        float total = 0;
+        for (auto &box : buf) {
+            total += exp(box.score);
+        }
+        FaceInfo rects;
+        memset(&rects, 0, sizeof(rects));
+        for (auto &box : buf) {
+            float rate = exp(box.score) / total;
+            rects.x1 += box.x1 * rate;
+            rects.y1 += box.y1 * rate;
+            rects.x2 += box.x2 * rate;
+            rects.y2 += box.y2 * rate;
+            rects.score += box.score * rate;
+        }
+        output.push_back(rects);
+    }
+}
+
+// nms [iterations]: every NmsEngine mode at 10, 100 and 1000 candidates, hard and blending next to the
+// previous implementation. Candidates cluster around a few faces like real detector output does.
+static int benchNms(int argc, char **argv) {
+    int iterations = argc > 0 ? stoi(argv[0]) : 200;
+    const int counts[] = {10, 100, 1000};
+    mt19937 rng(42);
+    uniform_real_distribution<float> unit(0, 1);
+    NmsEngine engine(0.3f, -1, 0.65f);
+
+    for (int count : counts) {
+        vector<FaceInfo> candidates;
+        int faces = max(1, count / 20);
+        for (int i = 0; i < count; i++) {
+            float seed_x = 60 + (i % faces) * 520.0f / faces;
+            float size = 40 + (i % faces) * 7;
+            float cx = seed_x + (unit(rng) - 0.5f) * size * 0.3f;
+            float cy = 240 + (unit(rng) - 0.5f) * size * 0.3f;
+            candidates.push_back({cx - size / 2, cy - size / 2, cx + size / 2, cy + size / 2,
+                                  0.65f + 0.35f * unit(rng)});
+        }
+
+        vector<FaceInfo> output;
+        for (int type = hard_nms; type <= soft_nms; type++) {
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                output.clear();
+                engine.run(candidates, output, type);
+            }
+            double engine_us = elapsedMs(start) * 1000 / iterations;
+            cout << count << " candidates, " << NmsEngine::typeName(type) << ": " << engine_us << " us, "
+                 << output.size() << " kept";
+            if (type == hard_nms || type == blending_nms) {
+                size_t kept = output.size();
+                start = chrono::steady_clock::now();
+                for (int i = 0; i < iterations; i++) {
+                    output.clear();
+                    referenceNms(candidates, output, type, 0.3f);
+                }
+                cout << " (previous nms " << elapsedMs(start) * 1000 / iterations << " us, " << output.size()
+                     << " kept)";
+                if (kept != output.size()) {
+                    cout << " MISMATCH";
+                }
+            }
+            cout << endl;
+        }
+    }
+    return 0;
+}
+
+// backends <model[@backend][,...]> [image] [iterations]: the same detect() loop on each backend, e.g.
+// slim-320.onnx,slim-320.mnn with the MNN model converted from the ONNX one. Faces are checked against the
+// first entry.
+static int benchBackends(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "backends needs a model path" << endl;
+        return 1;
+    }
+    string models = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    int iterations = argc > 2 ? stoi(argv[2]) : 100;
+    cv::Mat frame = loadFrame(image_path, cv::Size(320, 240));
+
+    vector<FaceInfo> reference;
+    size_t begin = 0;
+    for (int entry = 0; begin < models.size(); entry++) {
+        size_t end = models.find(',', begin);
+        string model_path = models.substr(begin, end == string::npos ? string::npos : end - begin);
+        begin = end == string::npos ? models.size() : end + 1;
+        string backend;
+        size_t at = model_path.find('@');
+        if (at != string::npos) {
+            backend = model_path.substr(at + 1);
+            model_path = model_path.substr(0, at);
+        }
+
+        auto construct_start = chrono::steady_clock::now();
+        UltraFace ultraface(model_path, 320, 240, 4, 0.65, 0.3, -1, backend);
+        double construct_ms = elapsedMs(construct_start);
+        vector<FaceInfo> faces;
+        if (ultraface.detect(frame, faces) != 0) {
+            cerr << model_path << ": detect failed" << endl;
+            return 1;
+        }
+        cout << model_path << " (" << ultraface.backendName() << "), load + warm-up " << construct_ms << " ms" << endl;
+
+        DetectTiming total = {0, 0, 0};
+        for (int i = 0; i < iterations; i++) {
+            faces.clear();
+            ultraface.detect(frame, faces);
+            const DetectTiming &timing = ultraface.getLastTiming();
+            total.pre_ms += timing.pre_ms;
+            total.infer_ms += timing.infer_ms;
+            total.post_ms += timing.post_ms;
+        }
+        printTiming("  detect", total, iterations);
+        cout << "  output bytes copied per frame: " << ultraface.getLastOutputBytesCopied() << endl;
+
+        if (entry == 0) {
+            reference = faces;
+            cout << "  " << faces.size() << " faces" << endl;
+            continue;
+        }
+        float max_delta = 0;
+        for (size_t i = 0; i < faces.size() && i < reference.size(); i++) {
+            max_delta = max({max_delta, fabs(faces[i].x1 - reference[i].x1), fabs(faces[i].y1 - reference[i].y1),
+                             fabs(faces[i].x2 - reference[i].x2), fabs(faces[i].y2 - reference[i].y2)});
+        }
+        cout << "  " << faces.size() << " faces (reference " << reference.size() << "), max box delta " << max_delta
+             << " px" << endl;
+    }
+    return 0;
+}
+
+// detect-threads <model> [image] [max_threads] [seconds]: aggregate detect() throughput with 1..max_threads
+// callers sharing one loaded model, each on its own context (session) with a single MNN thread
+static int benchDetectThreads(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "detect-threads needs a model path" << endl;
+        return 1;
+    }
+    string image_path = argc > 1 ? argv[1] : "";
+    int max_threads = argc > 2 ? stoi(argv[2]) : 4;
+    double seconds = argc > 3 ? stod(argv[3]) : 3.0;
+    cv::Mat frame = loadFrame(image_path, cv::Size(320, 240));
+    UltraFace ultraface(argv[0], 320, 240, 1, 0.65);
+
+    for (int threads = 1; threads <= max_threads; threads++) {
+        vector<unique_ptr<UltraFaceContext>> contexts;
+        for (int t = 0; t < threads; t++) {
+            contexts.push_back(ultraface.createContext());
+        }
+        atomic<bool> stop(false);
+        atomic<size_t> frames(0);
+        vector<thread> workers;
+        auto start = chrono::steady_clock::now();
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                vector<FaceInfo> faces;
+                while (!stop) {
+                    faces.clear();
+                    ultraface.detect(*contexts[t], frame, faces);
+                    frames++;
+                }
+            });
+        }
+        this_thread::sleep_for(chrono::duration<double>(seconds));
+        stop = true;
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        double elapsed = elapsedMs(start) / 1000;
+        cout << threads << " thread(s): " << frames / elapsed << " detections/s" << endl;
+    }
+    return 0;
+}
+
+static double residentMb() {
+    long pages = 0, resident = 0;
+    ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * (double) sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+// detect-pool <model> [image] [max_sessions] [seconds]: DetectorPool throughput, queue latency and
+// per-session utilization for 1..max_sessions, and resident memory per extra session next to the cost of
+// loading one more UltraFace instead
+static int benchDetectPool(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "detect-pool needs a model path" << endl;
+        return 1;
+    }
+    string model_path = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    int max_sessions = argc > 2 ? stoi(argv[2]) : 4;
+    double seconds = argc > 3 ? stod(argv[3]) : 3.0;
+    cv::Mat frame = loadFrame(image_path, cv::Size(320, 240));
+
+    double before = residentMb();
+    UltraFace ultraface(model_path, 320, 240, 1, 0.65);
+    double model_mb = residentMb() - before;
+    {
+        UltraFace second(model_path, 320, 240, 1, 0.65);
+        cout << "UltraFace instance: " << model_mb << " MB, another instance: " << residentMb() - before - model_mb
+             << " MB" << endl;
+    }
+
+    for (int sessions = 1; sessions <= max_sessions; sessions++) {
+        before = residentMb();
+        DetectorPool pool(ultraface, sessions);
+        double pool_mb = residentMb() - before;
+
+        // Keep two frames per session in flight, like a few streams feeding the pool
+        atomic<int> in_flight(0);
+        auto start = chrono::steady_clock::now();
+        while (elapsedMs(start) < seconds * 1000) {
+            if (in_flight >= sessions * 2) {
+                this_thread::sleep_for(chrono::microseconds(200));
+                continue;
+            }
+            in_flight++;
+            pool.submit(frame, PIXEL_FORMAT_BGR, [&in_flight](int, const vector<FaceInfo> &) { in_flight--; });
+        }
+        while (in_flight > 0) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        double elapsed = elapsedMs(start) / 1000;
+
+        DetectorPool::Stats stats = pool.getStats();
+        cout << sessions << " session(s): " << stats.completed / elapsed << " detections/s, queue "
+             << stats.queue_ms_avg << " ms avg / " << stats.queue_ms_max << " ms max, +" << pool_mb << " MB" << endl;
+        for (int i = 0; i < (int) stats.sessions.size(); i++) {
+            cout << "  session " << i << ": " << stats.sessions[i].jobs << " jobs, " << stats.sessions[i].stolen
+                 << " stolen, " << stats.sessions[i].utilization * 100 << "% busy" << endl;
+        }
+    }
+    return 0;
+}
+
+// detect-batch <model[,model...]> [image] [max_batch] [iterations]: detectBatch throughput for batch sizes
+// 1..max_batch, one curve per model (e.g. the slim and RFB 320 models)
+static int benchDetectBatch(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "detect-batch needs a model path" << endl;
+        return 1;
+    }
+    string models = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    int max_batch = argc > 2 ? stoi(argv[2]) : 8;
+    int iterations = argc > 3 ? stoi(argv[3]) : 50;
+    cv::Mat frame = loadFrame(image_path, cv::Size(320, 240));
+
+    size_t begin = 0;
+    while (begin < models.size()) {
+        size_t end = models.find(',', begin);
+        string model_path = models.substr(begin, end == string::npos ? string::npos : end - begin);
+        begin = end == string::npos ? models.size() : end + 1;
+
+        UltraFace ultraface(model_path, 320, 240, 4, 0.65);
+        cout << model_path << endl;
+        for (int batch = 1; batch <= max_batch; batch++) {
+            vector<cv::Mat> images(batch, frame);
+            vector<vector<FaceInfo>> faces;
+            ultraface.detectBatch(images, faces);  // Re-plans the session for this batch size
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                for (auto &list : faces) {
+                    list.clear();
+                }
+                ultraface.detectBatch(images, faces);
+            }
+            double ms = elapsedMs(start) / iterations;
+            cout << "  batch " << batch << ": " << ms << " ms/run, " << batch * 1000.0 / ms << " frames/s" << endl;
+        }
+    }
+    return 0;
+}
+
+// detect-pipeline <model> [image] [seconds]: frames/s and frame-to-result latency of serial detect() against
+// the three-stage DetectionPipeline, with a new frame always available
+static int benchDetectPipeline(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "detect-pipeline needs a model path" << endl;
+        return 1;
+    }
+    string model_path = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    double seconds = argc > 2 ? stod(argv[2]) : 5.0;
+    cv::Mat frame = loadFrame(image_path, cv::Size(320, 240));
+    UltraFace ultraface(model_path, 320, 240, 4, 0.65);
+
+    vector<FaceInfo> faces;
+    DetectTiming total = {0, 0, 0};
+    int frames = 0;
+    auto start = chrono::steady_clock::now();
+    while (elapsedMs(start) < seconds * 1000) {
+        faces.clear();
+        ultraface.detect(frame, faces);
+        const DetectTiming &timing = ultraface.getLastTiming();
+        total.pre_ms += timing.pre_ms;
+        total.infer_ms += timing.infer_ms;
+        total.post_ms += timing.post_ms;
+        frames++;
+    }
+    double elapsed = elapsedMs(start);
+    cout << "serial:   " << frames * 1000 / elapsed << " frames/s, latency " << elapsed / frames << " ms" << endl;
+    printTiming("  serial", total, frames);
+
+    DetectionPipeline pipeline(ultraface,
+        [&frame](cv::Mat &next, PixelFormat &format, int64_t &timestamp_us) {
+            next = frame;
+            format = PIXEL_FORMAT_BGR;
+            timestamp_us = FrameRing::now();
+            return true;
+        },
+        [](int64_t, const vector<FaceInfo> &, const DetectTiming &) {});
+    if (!pipeline.start()) {
+        return 1;
+    }
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    pipeline.stop();
+    DetectionPipeline::Stats stats = pipeline.getStats();
+    cout << "pipeline: " << stats.fps << " frames/s, latency " << stats.latency_ms_avg << " ms avg / "
+         << stats.latency_ms_max << " ms max" << endl;
+    cout << "  pipeline: pre " << stats.stage_ms[0] << " ms, infer " << stats.stage_ms[1] << " ms, post "
+         << stats.stage_ms[2] << " ms" << endl;
+    return 0;
+}
+
+// fused <model.onnx> <fused.onnx> [image] [iterations]: ONNX Runtime with C++ post-processing against the same
+// model with FaceDecodeNms in the graph (tools/fuse_postprocess.py, default thresholds). Faces must be identical.
+static int benchFused(int argc, char **argv) {
+    if (argc < 2) {
+        cerr << "fused needs the plain and the fused ONNX model" << endl;
+        return 1;
+    }
+    string image_path = argc > 2 ? argv[2] : "";
+    int iterations = argc > 3 ? stoi(argv[3]) : 100;
+    cv::Mat frame = loadFrame(image_path, cv::Size(320, 240));
+
+    vector<FaceInfo> results[2];
+    for (int m = 0; m < 2; m++) {
+        UltraFace ultraface(argv[m], 320, 240, 4, 0.7, 0.3, -1, "onnx");
+        DetectTiming total = {0, 0, 0};
+        for (int i = 0; i < iterations; i++) {
+            results[m].clear();
+            if (ultraface.detect(frame, results[m]) != 0) {
+                cerr << argv[m] << ": detect failed" << endl;
+                return 1;
+            }
+            const DetectTiming &timing = ultraface.getLastTiming();
+            total.pre_ms += timing.pre_ms;
+            total.infer_ms += timing.infer_ms;
+            total.post_ms += timing.post_ms;
+        }
+        printTiming(m == 0 ? "C++ post-processing" : "fused FaceDecodeNms", total, iterations);
+    }
+    cout << "graph output floats: " << AnchorTable(320, 240).size() * 6 << " vs " << results[1].size() * 6 << endl;
+
+    bool identical = results[0].size() == results[1].size();
+    for (size_t i = 0; identical && i < results[0].size(); i++) {
+        identical = memcmp(&results[0][i], &results[1][i], sizeof(FaceInfo)) == 0;
+    }
+    cout << results[0].size() << " vs " << results[1].size() << " faces, "
+         << (identical ? "identical" : "MISMATCH") << endl;
+    return identical ? 0 : 1;
+}
+
+// The source scaled by scale about its center, on a same-size gray canvas: a subject walking toward or
+// away from the camera
+static cv::Mat zoomFrame(const cv::Mat &source, double scale) {
+    cv::Mat frame(source.size(), source.type(), cv::Scalar(114, 114, 114));
+    cv::Mat scaled;
+    cv::resize(source, scaled, cv::Size(), scale, scale, scale < 1 ? cv::INTER_AREA : cv::INTER_LINEAR);
+    cv::Rect dst((frame.cols - scaled.cols) / 2, (frame.rows - scaled.rows) / 2, scaled.cols, scaled.rows);
+    cv::Rect visible = dst & cv::Rect(0, 0, frame.cols, frame.rows);
+    scaled(visible - dst.tl()).copyTo(frame(visible));
+    return frame;
+}
+
+// multiscale <model> [image] [frames] [sizes]: a zoom sweep from 0.25x to 1.5x of a 640x480 frame, detected
+// at the fixed 320x240 input and with MultiScaleDetector choosing per frame among sizes
+static int benchMultiScale(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "multiscale needs a model path" << endl;
+        return 1;
+    }
+    string model_path = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    int count = argc > 2 ? stoi(argv[2]) : 200;
+    vector<cv::Size> sizes = MultiScaleDetector::parseSizes(argc > 3 ? argv[3] : "160x120,320x240,640x480");
+    cv::Mat source = loadFrame(image_path, cv::Size(640, 480));
+
+    vector<cv::Mat> frames;
+    for (int i = 0; i < count; i++) {
+        double phase = 0.5 - 0.5 * cos(2 * M_PI * i / count);
+        frames.push_back(zoomFrame(source, 0.25 + 1.25 * phase));
+    }
+
+    UltraFace fixed(model_path, 320, 240, 4, 0.7);
+    MultiScaleDetector multiscale(model_path, sizes, cv::Size(320, 240), 4, 0.7);
+    double fixed_ms = 0;
+    int fixed_found = 0, multiscale_found = 0;
+    vector<FaceInfo> faces;
+    for (const cv::Mat &frame : frames) {
+        faces.clear();
+        fixed.detect(frame, faces);
+        const DetectTiming &timing = fixed.getLastTiming();
+        fixed_ms += timing.pre_ms + timing.infer_ms + timing.post_ms;
+        fixed_found += !faces.empty();
+
+        faces.clear();
+        multiscale.detect(frame, faces);
+        multiscale_found += !faces.empty();
+    }
+
+    MultiScaleDetector::Stats stats = multiscale.getStats();
+    cout << "fixed 320x240: " << fixed_ms / count << " ms/frame, face found in " << fixed_found << "/" << count
+         << " frames" << endl;
+    cout << "multi-scale:   " << stats.detect_ms_avg << " ms/frame, face found in " << multiscale_found << "/"
+         << count << " frames" << endl;
+    for (const auto &size : stats.sizes) {
+        cout << "  " << size.size.width << "x" << size.size.height << ": " << size.frames << " frames, "
+             << size.detect_ms_avg << " ms" << endl;
+    }
+    return 0;
+}
+
+// The source panning along a figure-eight across a 640x480 gray frame, optionally gone for the 60-70%
+// stretch of the run
+static vector<cv::Mat> panFrames(const cv::Mat &source, int count, bool with_gap) {
+    vector<cv::Mat> frames;
+    for (int i = 0; i < count; i++) {
+        cv::Mat frame(480, 640, source.type(), cv::Scalar(114, 114, 114));
+        if (!with_gap || i < count * 6 / 10 || i >= count * 7 / 10) {
+            double phase = 2 * M_PI * i / count;
+            int x = (int) ((frame.cols - source.cols) * (0.5 + 0.5 * sin(phase)));
+            int y = (int) ((frame.rows - source.rows) * (0.5 + 0.5 * sin(2 * phase)));
+            source.copyTo(frame(cv::Rect(x, y, source.cols, source.rows)));
+        }
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+// roi <model> [image] [frames] [interval]: the source at half size panning across a 640x480 frame and out of
+// view for a stretch, detected full-frame at 320x240 and with RoiDetector windows at 160x120
+static int benchRoi(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "roi needs a model path" << endl;
+        return 1;
+    }
+    string model_path = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    int count = argc > 2 ? stoi(argv[2]) : 300;
+    int interval = argc > 3 ? stoi(argv[3]) : 10;
+    vector<cv::Mat> frames = panFrames(loadFrame(image_path, cv::Size(320, 240)), count, true);
+
+    UltraFace fixed(model_path, 320, 240, 4, 0.7);
+    RoiDetector roi(model_path, cv::Size(320, 240), cv::Size(160, 120), interval, 4, 0.7);
+    double fixed_ms = 0, center_error = 0;
+    int fixed_found = 0, roi_found = 0, both_found = 0;
+    vector<FaceInfo> fixed_faces, roi_faces;
+    for (const cv::Mat &frame : frames) {
+        fixed_faces.clear();
+        fixed.detect(frame, fixed_faces);
+        const DetectTiming &timing = fixed.getLastTiming();
+        fixed_ms += timing.pre_ms + timing.infer_ms + timing.post_ms;
+        fixed_found += !fixed_faces.empty();
+
+        roi_faces.clear();
+        roi.detect(frame, roi_faces);
+        roi_found += !roi_faces.empty();
+
+        if (!fixed_faces.empty() && !roi_faces.empty()) {
+            both_found++;
+            center_error += hypot((fixed_faces[0].x1 + fixed_faces[0].x2 - roi_faces[0].x1 - roi_faces[0].x2) / 2,
+                                  (fixed_faces[0].y1 + fixed_faces[0].y2 - roi_faces[0].y1 - roi_faces[0].y2) / 2);
+        }
+    }
+
+    RoiDetector::Stats stats = roi.getStats();
+    double roi_ms = (stats.full_ms_avg * stats.full_frames + stats.roi_ms_avg * stats.roi_frames) / count;
+    cout << "full frame: " << fixed_ms / count << " ms/frame, face found in " << fixed_found << "/" << count
+         << " frames" << endl;
+    cout << "roi:        " << roi_ms << " ms/frame, face found in " << roi_found << "/" << count << " frames" << endl;
+    cout << "  " << stats.roi_frames << " window frames at " << stats.roi_ms_avg << " ms, " << stats.full_frames
+         << " full scans at " << stats.full_ms_avg << " ms" << endl;
+    cout << "  " << stats.losses << " losses, re-acquired in " << stats.reacquire_ms_avg << " ms avg, "
+         << stats.reacquire_ms_max << " ms max" << endl;
+    cout << "  face center " << (both_found ? center_error / both_found : 0) << " px from the full-frame result"
+         << endl;
+    return 0;
+}
+
+// tiled <model> [image] [frames] [frame_size] [overlap] [sessions]: frames (1280x960 by default) holding the
+// source at 8 to 30% size in a few places, detected whole at 320x240 and as 320x240 tiles, batched and on a
+// session pool. Recall counts
+// the pasted faces that a detection's center falls inside.
+static int benchTiled(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "tiled needs a model path" << endl;
+        return 1;
+    }
+    string model_path = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    int count = argc > 2 ? stoi(argv[2]) : 20;
+    cv::Size frame_size(1280, 960);
+    if (argc > 3 && sscanf(argv[3], "%dx%d", &frame_size.width, &frame_size.height) != 2) {
+        cerr << "frame_size is WIDTHxHEIGHT" << endl;
+        return 1;
+    }
+    float overlap = argc > 4 ? stof(argv[4]) : 0.2f;
+    int sessions = argc > 5 ? stoi(argv[5]) : 4;
+    cv::Mat source = loadFrame(image_path, cv::Size(320, 240));
+
+    // Where the face sits in the source, so it can be followed into every pasted copy
+    UltraFace reference(model_path, 320, 240, 4, 0.7);
+    vector<FaceInfo> faces;
+    reference.detect(source, faces);
+    if (faces.empty()) {
+        cerr << "no face in the source image" << endl;
+        return 1;
+    }
+    FaceInfo face = faces[0];
+
+    mt19937 rng(7);
+    vector<cv::Mat> frames;
+    vector<vector<FaceInfo>> truth;
+    for (int i = 0; i < count; i++) {
+        cv::Mat frame(frame_size, source.type(), cv::Scalar(114, 114, 114));
+        vector<FaceInfo> pasted;
+        for (int k = 0; k < 6; k++) {
+            double scale = uniform_real_distribution<double>(0.08, 0.3)(rng);
+            cv::Mat scaled;
+            cv::resize(source, scaled, cv::Size(), scale, scale, cv::INTER_AREA);
+            int x = uniform_int_distribution<int>(0, frame.cols - scaled.cols)(rng);
+            int y = uniform_int_distribution<int>(0, frame.rows - scaled.rows)(rng);
+            scaled.copyTo(frame(cv::Rect(x, y, scaled.cols, scaled.rows)));
+            pasted.push_back({(float) (x + face.x1 * scale), (float) (y + face.y1 * scale),
+                              (float) (x + face.x2 * scale), (float) (y + face.y2 * scale), face.score});
+        }
+        // Later pastes may cover earlier ones; only faces still fully visible count
+        truth.emplace_back();
+        for (size_t k = 0; k < pasted.size(); k++) {
+            bool covered = false;
+            for (size_t later = k + 1; later < pasted.size(); later++) {
+                const FaceInfo &a = pasted[k], &b = pasted[later];
+                covered |= a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+            }
+            if (!covered) {
+                truth.back().push_back(pasted[k]);
+            }
+        }
+        frames.push_back(frame);
+    }
+
+    UltraFace whole(model_path, 320, 240, 4, 0.7);
+    TiledDetector batched(model_path, cv::Size(320, 240), overlap, 1, 4, 0.7);
+    TiledDetector pooled(model_path, cv::Size(320, 240), overlap, sessions, 1, 0.7);
+    const char *labels[] = {"whole 320x240", "tiled batched", "tiled pooled"};
+    for (int mode = 0; mode < 3; mode++) {
+        int found = 0, total = 0, detections = 0;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            faces.clear();
+            if (mode == 0) {
+                whole.detect(frames[i], faces);
+            } else {
+                (mode == 1 ? batched : pooled).detect(frames[i], faces);
+            }
+            detections += faces.size();
+            for (const FaceInfo &t : truth[i]) {
+                total++;
+                for (const FaceInfo &f : faces) {
+                    float cx = (f.x1 + f.x2) / 2, cy = (f.y1 + f.y2) / 2;
+                    if (cx >= t.x1 && cx <= t.x2 && cy >= t.y1 && cy <= t.y2) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+        }
+        cout << labels[mode] << ": " << elapsedMs(start) / count << " ms/frame, recall " << found << "/" << total
+             << ", " << detections - found << " other detections" << endl;
+    }
+    cout << batched.tileRects(frame_size).size() << " tiles + whole frame per " << frame_size.width << "x"
+         << frame_size.height << " frame" << endl;
+    return 0;
+}
+
+// track <model> [image] [frames] [interval]: the panning face detected on every frame, and tracked with a
+// detection only every interval frames or when the match weakens. Error is the tracked face center's
+// distance from the every-frame detection.
+static int benchTrack(int argc, char **argv) {
+    if (argc < 1) {
+        cerr << "track needs a model path" << endl;
+        return 1;
+    }
+    string model_path = argv[0];
+    string image_path = argc > 1 ? argv[1] : "";
+    int count = argc > 2 ? stoi(argv[2]) : 300;
+    int interval = argc > 3 ? stoi(argv[3]) : 10;
+    vector<cv::Mat> frames = panFrames(loadFrame(image_path, cv::Size(320, 240)), count, false);
+
+    UltraFace detector(model_path, 320, 240, 4, 0.7);
+    FaceTracker tracker(interval);
+    vector<FaceInfo> reference, faces;
+    double detect_ms = 0, tracked_ms = 0, error_total = 0, error_max = 0;
+    int detections = 0, compared = 0;
+    for (const cv::Mat &frame : frames) {
+        reference.clear();
+        auto start = chrono::steady_clock::now();
+        detector.detect(frame, reference);
+        detect_ms += elapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        FaceInfo face;
+        bool found = !tracker.needsDetection() && tracker.update(frame, PIXEL_FORMAT_BGR, face);
+        if (!found) {
+            faces.clear();
+            detector.detect(frame, faces);
+            tracker.sync(frame, PIXEL_FORMAT_BGR, faces);
+            detections++;
+            found = !faces.empty();
+            if (found) {
+                face = faces[0];
+            }
+        }
+        tracked_ms += elapsedMs(start);
+
+        if (found && !reference.empty()) {
+            double error = hypot((face.x1 + face.x2 - reference[0].x1 - reference[0].x2) / 2,
+                                 (face.y1 + face.y2 - reference[0].y1 - reference[0].y2) / 2);
+            error_total += error;
+            error_max = max(error_max, error);
+            compared++;
+        }
+    }
+
+    FaceTracker::Stats stats = tracker.getStats();
+    cout << "detect every frame: " << detect_ms / count << " ms/frame" << endl;
+    cout << "track + detect:     " << tracked_ms / count << " ms/frame, " << detections << "/" << count
+         << " frames detected" << endl;
+    cout << "  tracker " << stats.track_ms_avg << " ms/update, " << stats.updates << " tracked, " << stats.lost
+         << " lost, confidence " << stats.confidence_avg << endl;
+    cout << "  face center " << (compared ? error_total / compared : 0) << " px avg, " << error_max
+         << " px max from the every-frame detection" << endl;
+    return 0;
+}
+
+static void usage() {
+    cout << "Usage: ./benchmark <suite> [args...]" << endl;
+    cout << "  jpeg [image] [iterations]    JPEG decode to 320x240 per backend" << endl;
+    cout << "  decode-pool [image] [max_workers] [seconds]    720p decode throughput per worker count" << endl;
+    cout << "  detect <model> [image] [iterations]    UltraFace pre/infer/post latency" << endl;
+    cout << "  backends <model[@backend][,...]> [image] [iterations]    detect() per inference backend" << endl;
+    cout << "  fused <model.onnx> <fused.onnx> [image] [iterations]    C++ vs in-graph decode + NMS" << endl;
+    cout << "  detect-threads <model> [image] [max_threads] [seconds]    shared-model throughput per caller count" << endl;
+    cout << "  detect-pool <model> [image] [max_sessions] [seconds]    session pool scaling and memory" << endl;
+    cout << "  detect-batch <model[,model...]> [image] [max_batch] [iterations]    batched throughput curve" << endl;
+    cout << "  detect-pipeline <model> [image] [seconds]    serial vs three-stage pipelined detection" << endl;
+    cout << "  multiscale <model> [image] [frames] [sizes]    per-frame input size vs fixed 320x240" << endl;
+    cout << "  roi <model> [image] [frames] [interval]    windowed tracking vs full-frame detection" << endl;
+    cout << "  tiled <model> [image] [frames] [frame_size] [overlap] [sessions]    small-face recall and cost of tiling" << endl;
+    cout << "  track <model> [image] [frames] [interval]    template tracking between detections vs detecting every frame" << endl;
+    cout << "  preprocess [image] [iterations] [model]    two-pass vs fused input preprocessing, speed and accuracy" << endl;
+    cout << "  record <model> <image> <prefix>    save raw model outputs for decode" << endl;
+    cout << "  decode <prefix> [threshold] [iterations]    scalar vs vectorized box decode" << endl;
+    cout << "  nms [iterations]    NMS modes at 10, 100 and 1000 candidates" << endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    string suite = argv[1];
+    if (suite == "jpeg") {
+        return benchJpeg(argc - 2, argv + 2);
+    }
+    if (suite == "decode-pool") {
+        return benchDecodePool(argc - 2, argv + 2);
+    }
+    if (suite == "detect") {
+        return benchDetect(argc - 2, argv + 2);
+    }
+    if (suite == "backends") {
+        return benchBackends(argc - 2, argv + 2);
+    }
+    if (suite == "fused") {
+        return benchFused(argc - 2, argv + 2);
+    }
+    if (suite == "detect-threads") {
+        return benchDetectThreads(argc - 2, argv + 2);
+    }
+    if (suite == "detect-pool") {
+        return benchDetectPool(argc - 2, argv + 2);
+    }
+    if (suite == "detect-batch") {
+        return benchDetectBatch(argc - 2, argv + 2);
+    }
+    if (suite == "detect-pipeline") {
+        return benchDetectPipeline(argc - 2, argv + 2);
+    }
+    if (suite == "multiscale") {
+        return benchMultiScale(argc - 2, argv + 2);
+    }
+    if (suite == "roi") {
+        return benchRoi(argc - 2, argv + 2);
+    }
+    if (suite == "tiled") {
+        return benchTiled(argc - 2, argv + 2);
+    }
+    if (suite == "track") {
+        return benchTrack(argc - 2, argv + 2);
+    }
+    if (suite == "preprocess") {
+        return benchPreprocess(argc - 2, argv + 2);
+    }
+    if (suite == "record") {
+        return benchRecord(argc - 2, argv + 2);
+    }
+    if (suite == "decode") {
+        return benchDecode(argc - 2, argv + 2);
+    }
+    if (suite == "nms") {
+        return benchNms(argc - 2, argv + 2);
+    }
+    usage();
+    return 1;
+}
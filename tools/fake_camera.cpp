@@ -0,0 +1,256 @@
+// Stand-in for mjpg-streamer, for benchmarking capture + detection without a camera.
+// Serves /?action=snapshot and /?action=stream from a directory of JPEGs or a video file.
+// Usage: ./fake_camera --source <dir|video> [--port 8080] [--fps 30] [--width W --height H]
+//                      [--quality 80] [--jitter-ms 0] [--latency-ms 0] [--max-frames 300]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+
+#define BOUNDARY "boundarydonotcross"
+
+struct Options {
+    string source;
+    int port = 8080;
+    double fps = 30;
+    int width = 0;   // 0 keeps the source size
+    int height = 0;
+    int quality = 80;
+    int jitter_ms = 0;
+    int latency_ms = 0;
+    int max_frames = 300;
+};
+
+static Options options;
+static vector<vector<uchar>> frames;
+static chrono::steady_clock::time_point start_time;
+
+static vector<uchar> encodeFrame(const cv::Mat &image) {
+    cv::Mat resized = image;
+    if (options.width > 0 && options.height > 0 && image.size() != cv::Size(options.width, options.height)) {
+        cv::resize(image, resized, cv::Size(options.width, options.height), 0, 0, cv::INTER_AREA);
+    }
+    vector<uchar> jpeg;
+    cv::imencode(".jpg", resized, jpeg, {cv::IMWRITE_JPEG_QUALITY, options.quality});
+    return jpeg;
+}
+
+static bool loadFrames() {
+    struct stat st;
+    if (stat(options.source.c_str(), &st) != 0) {
+        cerr << "Cannot open " << options.source << endl;
+        return false;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        vector<cv::String> paths;
+        cv::glob(options.source + "/*.jpg", paths);
+        sort(paths.begin(), paths.end());
+        for (auto &path : paths) {
+            if ((int) frames.size() >= options.max_frames) {
+                break;
+            }
+            if (options.width == 0 || options.height == 0) {
+                // Serve the files untouched, exactly as a camera produced them
+                ifstream file(path, ios::binary);
+                frames.emplace_back(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+            } else {
+                cv::Mat image = cv::imread(path);
+                if (!image.empty()) {
+                    frames.push_back(encodeFrame(image));
+                }
+            }
+        }
+    } else {
+        cv::VideoCapture video(options.source);
+        cv::Mat image;
+        while ((int) frames.size() < options.max_frames && video.read(image)) {
+            frames.push_back(encodeFrame(image));
+        }
+    }
+
+    if (frames.empty()) {
+        cerr << "No frames found in " << options.source << endl;
+        return false;
+    }
+    return true;
+}
+
+// The frame a live camera would be showing right now
+static const vector<uchar> &currentFrame() {
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    return frames[(size_t) (elapsed * options.fps) % frames.size()];
+}
+
+static bool sendAll(int fd, const void *data, size_t size) {
+    const char *p = (const char *) data;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool sendString(int fd, const string &text) {
+    return sendAll(fd, text.data(), text.size());
+}
+
+static void injectDelay(mt19937 &rng) {
+    int delay = options.latency_ms;
+    if (options.jitter_ms > 0) {
+        delay += uniform_int_distribution<int>(0, options.jitter_ms)(rng);
+    }
+    if (delay > 0) {
+        this_thread::sleep_for(chrono::milliseconds(delay));
+    }
+}
+
+static void serveSnapshot(int fd, mt19937 &rng) {
+    // The frame is picked at request time and arrives late, like one from a camera with a slow link
+    const vector<uchar> &jpeg = currentFrame();
+    injectDelay(rng);
+    sendString(fd, "HTTP/1.0 200 OK\r\nConnection: close\r\nCache-Control: no-cache\r\n"
+                   "Content-Type: image/jpeg\r\nContent-Length: " + to_string(jpeg.size()) + "\r\n\r\n");
+    sendAll(fd, jpeg.data(), jpeg.size());
+}
+
+static void serveStream(int fd, mt19937 &rng) {
+    if (!sendString(fd, "HTTP/1.0 200 OK\r\nConnection: close\r\nCache-Control: no-cache\r\n"
+                        "Content-Type: multipart/x-mixed-replace;boundary=" BOUNDARY "\r\n\r\n--" BOUNDARY "\r\n")) {
+        return;
+    }
+
+    auto period = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / options.fps));
+    auto next = chrono::steady_clock::now();
+    while (true) {
+        // Latency and jitter delay each frame after it is captured but do not change the average rate
+        const vector<uchar> &jpeg = currentFrame();
+        double timestamp = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        injectDelay(rng);
+        string header = "Content-Type: image/jpeg\r\nContent-Length: " + to_string(jpeg.size()) +
+                        "\r\nX-Timestamp: " + to_string(timestamp) + "\r\n\r\n";
+        if (!sendString(fd, header) || !sendAll(fd, jpeg.data(), jpeg.size()) ||
+            !sendString(fd, "\r\n--" BOUNDARY "\r\n")) {
+            return;
+        }
+        next += period;
+        this_thread::sleep_until(next);
+    }
+}
+
+static void handleClient(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == string::npos && request.size() < 8192) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            close(fd);
+            return;
+        }
+        request.append(buffer, n);
+    }
+
+    mt19937 rng(random_device{}());
+    string line = request.substr(0, request.find("\r\n"));
+    if (line.find("action=stream") != string::npos) {
+        serveStream(fd, rng);
+    } else if (line.find("action=snapshot") != string::npos) {
+        serveSnapshot(fd, rng);
+    } else {
+        sendString(fd, "HTTP/1.0 404 Not Found\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+    }
+    close(fd);
+}
+
+static bool parseOptions(int argc, char **argv) {
+    for (int i = 1; i < argc; i += 2) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return false;
+        }
+        string value = argv[i + 1];
+        if (arg == "--source") {
+            options.source = value;
+        } else if (arg == "--port") {
+            options.port = stoi(value);
+        } else if (arg == "--fps") {
+            options.fps = stod(value);
+        } else if (arg == "--width") {
+            options.width = stoi(value);
+        } else if (arg == "--height") {
+            options.height = stoi(value);
+        } else if (arg == "--quality") {
+            options.quality = stoi(value);
+        } else if (arg == "--jitter-ms") {
+            options.jitter_ms = stoi(value);
+        } else if (arg == "--latency-ms") {
+            options.latency_ms = stoi(value);
+        } else if (arg == "--max-frames") {
+            options.max_frames = stoi(value);
+        } else {
+            cerr << "Unknown option " << arg << endl;
+            return false;
+        }
+    }
+    return !options.source.empty() && options.fps > 0;
+}
+
+int main(int argc, char **argv) {
+    if (!parseOptions(argc, argv)) {
+        cerr << "Usage: ./fake_camera --source <dir|video> [--port 8080] [--fps 30] [--width W --height H]"
+             << " [--quality 80] [--jitter-ms 0] [--latency-ms 0] [--max-frames 300]" << endl;
+        return 1;
+    }
+    if (!loadFrames()) {
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(options.port);
+    if (bind(server, (sockaddr *) &addr, sizeof(addr)) != 0 || listen(server, 8) != 0) {
+        cerr << "Cannot listen on port " << options.port << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    start_time = chrono::steady_clock::now();
+    cout << "Serving " << frames.size() << " frames at " << options.fps << " fps on http://localhost:"
+         << options.port << "/?action=stream" << endl;
+    while (true) {
+        int client = accept(server, nullptr, nullptr);
+        if (client >= 0) {
+            thread(handleClient, client).detach();
+        }
+    }
+}
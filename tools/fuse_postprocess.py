@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# Appends the FaceDecodeNms custom op (src/FaceDecodeNmsOp.cpp) to an UltraFace ONNX export, so the graph
+# returns the final faces instead of every anchor's scores and boxes. Load the result with the onnx backend.
+# Usage: ./fuse_postprocess.py <in.onnx> <out.onnx> [--width 320 --height 240] [--score-threshold 0.7]
+#                              [--iou-threshold 0.3] [--nms blending] [--topk -1]
+
+import argparse
+
+import numpy as np
+import onnx
+from onnx import TensorProto, helper, numpy_helper
+
+DOMAIN = "ai.smartcam"
+NMS_TYPES = {"hard": 1, "blending": 2, "fast": 3, "soft": 4}  # NmsEngine.hpp
+
+STRIDES = [8, 16, 32, 64]
+MIN_BOXES = [[10.0, 16.0, 24.0], [32.0, 48.0], [64.0, 96.0], [128.0, 192.0, 256.0]]
+
+
+def clip1(x):
+    return np.float32(min(max(x, np.float32(0)), np.float32(1)))
+
+
+# Four planes (cx, cy, w, h) with the same floats as AnchorTable: centers in double from a float scale,
+# sizes in float
+def anchors(in_w, in_h):
+    cx, cy, w, h = [], [], [], []
+    for stride, sizes in zip(STRIDES, MIN_BOXES):
+        fm_w = (in_w + stride - 1) // stride
+        fm_h = (in_h + stride - 1) // stride
+        scale_w = np.float32(in_w) / np.float32(stride)
+        scale_h = np.float32(in_h) / np.float32(stride)
+        for j in range(fm_h):
+            for i in range(fm_w):
+                x_center = np.float32((i + 0.5) / np.float64(scale_w))
+                y_center = np.float32((j + 0.5) / np.float64(scale_h))
+                for size in sizes:
+                    cx.append(clip1(x_center))
+                    cy.append(clip1(y_center))
+                    w.append(clip1(np.float32(size) / np.float32(in_w)))
+                    h.append(clip1(np.float32(size) / np.float32(in_h)))
+    return np.array([cx, cy, w, h], dtype=np.float32)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("input")
+    parser.add_argument("output")
+    parser.add_argument("--width", type=int, default=320)
+    parser.add_argument("--height", type=int, default=240)
+    parser.add_argument("--score-threshold", type=float, default=0.7)
+    parser.add_argument("--iou-threshold", type=float, default=0.3)
+    parser.add_argument("--nms", choices=NMS_TYPES.keys(), default="blending")
+    parser.add_argument("--topk", type=int, default=-1)
+    args = parser.parse_args()
+
+    model = onnx.load(args.input)
+    graph = model.graph
+    outputs = {output.name for output in graph.output}
+    if outputs != {"scores", "boxes"}:
+        raise SystemExit("expected an UltraFace graph with scores and boxes outputs, got %s" % sorted(outputs))
+
+    table = anchors(args.width, args.height)
+    graph.initializer.append(numpy_helper.from_array(table, "anchors"))
+    batch = graph.input[0].type.tensor_type.shape.dim[0]
+    batch_dim = batch.dim_param if batch.HasField("dim_param") else batch.dim_value
+    graph.input.append(helper.make_tensor_value_info("image_sizes", TensorProto.FLOAT, [batch_dim, 2]))
+    graph.node.append(helper.make_node(
+        "FaceDecodeNms", ["scores", "boxes", "anchors", "image_sizes"], ["faces"], domain=DOMAIN,
+        score_threshold=args.score_threshold, iou_threshold=args.iou_threshold, nms_type=NMS_TYPES[args.nms],
+        topk=args.topk, center_variance=0.1, size_variance=0.2))
+    del graph.output[:]
+    graph.output.append(helper.make_tensor_value_info("faces", TensorProto.FLOAT, ["faces", 6]))
+    model.opset_import.append(helper.make_opsetid(DOMAIN, 1))
+
+    onnx.save(model, args.output)
+    print("%s: %d anchors, FaceDecodeNms(score %.2f, iou %.2f, %s nms, topk %d)"
+          % (args.output, table.shape[1], args.score_threshold, args.iou_threshold, args.nms, args.topk))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,290 @@
+// Runs V4l2FrameSource against a fake ioctl shim instead of a real /dev/videoN, so the capture cycle can be
+// checked on any machine: ./v4l2_check, or make check. Exits non-zero if any expectation fails.
+#include <errno.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "V4l2FrameSource.hpp"
+
+using namespace std;
+
+#define FAKE_FD 42
+#define FAKE_WIDTH 640
+#define FAKE_HEIGHT 480
+#define FAKE_STRIDE (FAKE_WIDTH * 2)
+#define FAKE_BUFFER_SIZE (FAKE_STRIDE * FAKE_HEIGHT)
+
+// What the next poll()/VIDIOC_DQBUF does
+enum FakeEvent {
+    EVENT_FRAME,        // Buffer filled with bytesused bytes
+    EVENT_ERROR_FLAG,   // Buffer returned with V4L2_BUF_FLAG_ERROR
+    EVENT_POLL_EINTR,   // poll() interrupted by a signal
+    EVENT_POLL_TIMEOUT,
+    EVENT_DQBUF_EAGAIN, // poll() said ready but the buffer was taken back
+    EVENT_DQBUF_EINTR   // DQBUF interrupted once, then succeeds
+};
+
+struct Step {
+    FakeEvent event;
+    unsigned int bytesused;
+};
+
+struct FakeDevice {
+    bool supports_mjpeg;
+    unsigned int pixel_format;
+    bool streaming;
+    bool stream_off;
+    bool open;
+    deque<Step> script;
+    deque<unsigned int> queued;  // Buffer indices owned by the driver, in fill order
+    map<off_t, vector<unsigned char>> memory;
+    int mapped;
+    atomic<bool>* running;  // Cleared once the script has played out
+    int dqbuf_count;
+    int qbuf_count;
+    bool retry_pending;
+} fake;
+
+static void finishIfDone() {
+    if (fake.script.empty()) {
+        *fake.running = false;
+    }
+}
+
+static int fakeOpen(const char* path, int flags) {
+    fake.open = true;
+    return FAKE_FD;
+}
+
+static int fakeClose(int fd) {
+    fake.open = false;
+    return 0;
+}
+
+static int fakePoll(int fd, int timeout_ms) {
+    if (fake.script.empty()) {
+        return 0;
+    }
+    FakeEvent event = fake.script.front().event;
+    if (event == EVENT_POLL_EINTR || event == EVENT_POLL_TIMEOUT) {
+        fake.script.pop_front();
+        finishIfDone();
+        if (event == EVENT_POLL_TIMEOUT) {
+            return 0;
+        }
+        errno = EINTR;
+        return -1;
+    }
+    return 1;
+}
+
+static int fakeIoctl(int fd, unsigned long request, void* arg) {
+    switch (request) {
+    case VIDIOC_QUERYCAP: {
+        struct v4l2_capability* cap = (struct v4l2_capability*) arg;
+        cap->capabilities = V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING;
+        return 0;
+    }
+    case VIDIOC_S_FMT: {
+        struct v4l2_format* fmt = (struct v4l2_format*) arg;
+        if (fmt->fmt.pix.pixelformat == V4L2_PIX_FMT_MJPEG && !fake.supports_mjpeg) {
+            fmt->fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;  // Drivers answer with what they can do
+            return 0;
+        }
+        fake.pixel_format = fmt->fmt.pix.pixelformat;
+        fmt->fmt.pix.width = FAKE_WIDTH;
+        fmt->fmt.pix.height = FAKE_HEIGHT;
+        fmt->fmt.pix.bytesperline = fake.pixel_format == V4L2_PIX_FMT_YUYV ? FAKE_STRIDE : 0;
+        return 0;
+    }
+    case VIDIOC_S_PARM:
+        return 0;
+    case VIDIOC_REQBUFS: {
+        struct v4l2_requestbuffers* req = (struct v4l2_requestbuffers*) arg;
+        req->count = min(req->count, 3u);
+        return 0;
+    }
+    case VIDIOC_QUERYBUF: {
+        struct v4l2_buffer* buf = (struct v4l2_buffer*) arg;
+        buf->length = FAKE_BUFFER_SIZE;
+        buf->m.offset = buf->index * 4096 * 1024;
+        return 0;
+    }
+    case VIDIOC_QBUF: {
+        struct v4l2_buffer* buf = (struct v4l2_buffer*) arg;
+        fake.queued.push_back(buf->index);
+        fake.qbuf_count++;
+        return 0;
+    }
+    case VIDIOC_STREAMON:
+        fake.streaming = true;
+        return 0;
+    case VIDIOC_STREAMOFF:
+        fake.streaming = false;
+        fake.stream_off = true;
+        return 0;
+    case VIDIOC_DQBUF: {
+        if (!fake.streaming || fake.queued.empty() || fake.script.empty()) {
+            errno = EINVAL;
+            return -1;
+        }
+        Step step = fake.script.front();
+        if (step.event == EVENT_DQBUF_EAGAIN) {
+            fake.script.pop_front();
+            finishIfDone();
+            errno = EAGAIN;
+            return -1;
+        }
+        if (step.event == EVENT_DQBUF_EINTR && !fake.retry_pending) {
+            fake.retry_pending = true;
+            errno = EINTR;
+            return -1;
+        }
+        fake.retry_pending = false;
+        fake.script.pop_front();
+        struct v4l2_buffer* buf = (struct v4l2_buffer*) arg;
+        buf->index = fake.queued.front();
+        fake.queued.pop_front();
+        buf->bytesused = step.event == EVENT_DQBUF_EINTR ? FAKE_BUFFER_SIZE : step.bytesused;
+        buf->flags = step.event == EVENT_ERROR_FLAG ? V4L2_BUF_FLAG_ERROR : 0;
+        // Stamp the buffer so the callback can tell which one it was handed
+        fake.memory[buf->index * 4096 * 1024][0] = (unsigned char) (0xA0 + buf->index);
+        fake.dqbuf_count++;
+        finishIfDone();
+        return 0;
+    }
+    }
+    errno = ENOTTY;
+    return -1;
+}
+
+static void* fakeMmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset) {
+    vector<unsigned char>& memory = fake.memory[offset];
+    memory.assign(length, 0);
+    fake.mapped++;
+    return memory.data();
+}
+
+static int fakeMunmap(void* addr, size_t length) {
+    fake.mapped--;
+    return 0;
+}
+
+static const V4l2DeviceOps fake_ops = {fakeOpen, fakeClose, fakeIoctl, fakeMmap, fakeMunmap, fakePoll};
+
+static int failures = 0;
+
+static void expect(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        failures++;
+    }
+}
+
+struct Delivered {
+    const unsigned char* data;
+    size_t size;
+    FrameEncoding encoding;
+    int width;
+    int height;
+    unsigned char stamp;
+};
+
+static vector<Delivered> runScript(bool supports_mjpeg, const vector<Step>& script, int width = FAKE_WIDTH,
+                                   int height = FAKE_HEIGHT) {
+    atomic<bool> running(true);
+    fake = FakeDevice();
+    fake.supports_mjpeg = supports_mjpeg;
+    fake.script.assign(script.begin(), script.end());
+    fake.running = &running;
+
+    vector<Delivered> delivered;
+    V4l2FrameSource source("/dev/fake", width, height, 30, 4, fake_ops);
+    bool ok = source.run(running, [&delivered](const CapturedFrame& frame) {
+        delivered.push_back({frame.data, frame.size, frame.encoding, frame.width, frame.height, frame.data[0]});
+        expect(frame.bytes_copied == 0, "frames are handed over without copying");
+    });
+    expect(ok, "run() returns true after a clean stop");
+    expect(!fake.streaming && fake.stream_off, "VIDIOC_STREAMOFF on exit");
+    expect(fake.mapped == 0, "every buffer unmapped on exit");
+    expect(!fake.open, "device closed on exit");
+    expect(fake.qbuf_count == 3 + fake.dqbuf_count, "every dequeued buffer is queued again");
+    return delivered;
+}
+
+static bool isMapped(const unsigned char* data) {
+    for (auto& entry : fake.memory) {
+        if (entry.second.data() == data) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void checkMjpeg() {
+    vector<Delivered> frames = runScript(true, {{EVENT_FRAME, 5000}, {EVENT_FRAME, 7000}, {EVENT_FRAME, 6000},
+                                                {EVENT_FRAME, 9000}, {EVENT_FRAME, 4000}});
+    expect(frames.size() == 5, "MJPEG: five frames delivered");
+    for (size_t i = 0; i < frames.size(); i++) {
+        expect(frames[i].encoding == FRAME_ENCODING_JPEG, "MJPEG: encoding reported as JPEG");
+        expect(isMapped(frames[i].data), "MJPEG: frame points into an mmap'd buffer");
+        expect(frames[i].stamp == 0xA0 + i % 3, "MJPEG: buffers cycle in queue order");
+    }
+    expect(frames.size() == 5 && frames[0].size == 5000 && frames[3].size == 9000, "MJPEG: size is bytesused");
+}
+
+static void checkYuyv() {
+    vector<Delivered> frames = runScript(false, {{EVENT_FRAME, FAKE_BUFFER_SIZE}, {EVENT_FRAME, FAKE_BUFFER_SIZE},
+                                                 {EVENT_FRAME, FAKE_BUFFER_SIZE}});
+    expect(frames.size() == 3, "YUYV: three frames delivered");
+    for (const Delivered& frame : frames) {
+        expect(frame.encoding == FRAME_ENCODING_YUYV, "YUYV: encoding reported as YUYV after MJPEG is refused");
+        expect(isMapped(frame.data), "YUYV: frame points into an mmap'd buffer");
+    }
+}
+
+static void checkRetries() {
+    vector<Delivered> frames = runScript(true, {{EVENT_POLL_EINTR, 0}, {EVENT_FRAME, 1000}, {EVENT_POLL_TIMEOUT, 0},
+                                                {EVENT_DQBUF_EAGAIN, 0}, {EVENT_DQBUF_EINTR, 0},
+                                                {EVENT_FRAME, 2000}});
+    expect(frames.size() == 3, "EINTR/EAGAIN: poll and DQBUF interruptions are retried without losing frames");
+}
+
+static void checkShortBuffers() {
+    vector<Delivered> frames = runScript(false, {{EVENT_FRAME, FAKE_BUFFER_SIZE}, {EVENT_FRAME, FAKE_BUFFER_SIZE / 2},
+                                                 {EVENT_FRAME, 0}, {EVENT_ERROR_FLAG, FAKE_BUFFER_SIZE},
+                                                 {EVENT_FRAME, FAKE_BUFFER_SIZE}});
+    expect(frames.size() == 2, "short, empty and error-flagged buffers are dropped");
+
+    frames = runScript(true, {{EVENT_FRAME, 0}, {EVENT_FRAME, 300}});
+    expect(frames.size() == 1 && frames[0].size == 300, "MJPEG: empty buffers dropped, small JPEGs kept");
+}
+
+// The fake driver only does FAKE_WIDTH x FAKE_HEIGHT, whatever is asked for
+static void checkNegotiatedSize() {
+    vector<Delivered> frames = runScript(false, {{EVENT_FRAME, FAKE_BUFFER_SIZE}}, 1280, 720);
+    expect(frames.size() == 1, "YUYV: a full frame at the driver's size is not taken for a short one");
+    expect(frames.size() == 1 && frames[0].width == FAKE_WIDTH && frames[0].height == FAKE_HEIGHT,
+           "frames carry the size the driver settled on, not the one asked for");
+}
+
+int main() {
+    checkMjpeg();
+    checkYuyv();
+    checkRetries();
+    checkShortBuffers();
+    checkNegotiatedSize();
+    if (failures) {
+        cerr << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "v4l2_check: all checks passed" << endl;
+    return 0;
+}